@@ -0,0 +1,58 @@
+cmake_minimum_required( VERSION 3.13 )
+
+#
+# use installed Google Benchmark if any
+#
+find_package( benchmark CONFIG QUIET )
+
+if ( NOT benchmark_FOUND )
+    #
+    # define path for Google Benchmark as external project
+    #
+    set( external_dir ${PROJECT_SOURCE_DIR}/external )
+    set( benchmark_dir ${external_dir}/benchmark )
+    set( benchmark_cmake ${benchmark_dir}/CMakeLists.txt )
+
+    if ( NOT EXISTS ${benchmark_cmake} )
+        #
+        # make sure ./external folder exists and does not contain benchmark folder
+        #
+        file( MAKE_DIRECTORY ${external_dir} )
+        file( REMOVE_RECURSE ${benchmark_dir} )
+
+        #
+        # gonna use Git to download Google Benchmark from Github
+        #
+        find_package( Git )
+        if ( NOT Git_FOUND )
+            message( FATAL_ERROR "Unable to locate Git package!" )
+        endif()
+
+        #
+        # download Google Benchmark
+        #
+        execute_process(
+            COMMAND ${GIT_EXECUTABLE} clone --depth=1 --branch=main https://github.com/google/benchmark
+            WORKING_DIRECTORY ${external_dir}
+            TIMEOUT 14400
+            RESULT_VARIABLE git_result
+        )
+
+        if ( NOT git_result EQUAL 0 )
+            message( FATAL_ERROR "Unable to download Google Benchmark library!" )
+        endif()
+    endif()
+
+    #
+    # suppress Google Benchmark own tests
+    #
+    set( BENCHMARK_ENABLE_TESTING OFF CACHE BOOL "" FORCE )
+    set( BENCHMARK_ENABLE_GTEST_TESTS OFF CACHE BOOL "" FORCE )
+    set( BENCHMARK_ENABLE_INSTALL OFF CACHE BOOL "" FORCE )
+
+    #
+    # add Google Benchmark project
+    #
+    add_subdirectory( ${benchmark_dir} )
+    set_target_properties( benchmark benchmark_main PROPERTIES FOLDER external )
+endif()
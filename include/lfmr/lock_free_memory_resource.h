@@ -33,6 +33,16 @@
 #include <type_traits>
 #include <atomic>
 #include <thread>
+#include <chrono>
+#include <array>
+#include <initializer_list>
+#include <algorithm>
+#include <limits>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cstddef>
+#include <utility>
 #include <assert.h>
 #ifdef _WIN32
 #   include <windows.h>
@@ -45,13 +55,169 @@
 #else
 #   include <unistd.h>
 #   include <sys/mman.h>
+#   if defined( __linux__ ) && __has_include( <sys/rseq.h> ) && defined( __has_builtin )
+#       include <sys/rseq.h>
+#       if defined( RSEQ_SIG ) && __has_builtin( __builtin_thread_pointer )
+#           define LFMR_RSEQ
+#           if ( defined( __x86_64__ ) || defined( __aarch64__ ) ) && __has_include( <linux/membarrier.h> )
+#               include <sys/syscall.h>
+#               include <linux/membarrier.h>
+#               define LFMR_RSEQ_CRITICAL_SECTIONS
+#           endif
+#       endif
+#   endif
+#endif
+
+
+//
+// Frame of rseq critical section modifying CPU cache: the descriptor, its registration in rseq area, check of
+// current CPU and busy_ flag of the cache, and the abort handler preceded by the signature. A body placed between
+// LFMR_RSEQ_BEGIN and LFMR_RSEQ_END ends with the commit store and jumps to label 6 if the cache cannot serve the
+// operation. The status is 0 if committed, 1 if aborted or migrated, 2 if failed, 3 if the cache is busy
+//
+#ifdef LFMR_RSEQ_CRITICAL_SECTIONS
+#   if defined( __x86_64__ )
+#       define LFMR_RSEQ_SIG RSEQ_SIG
+#       define LFMR_RSEQ_BEGIN \
+            ".pushsection __rseq_cs, \"aw\"\n\t" \
+            ".balign 32\n\t" \
+            "3:\n\t" \
+            ".long 0, 0\n\t" \
+            ".quad 1f, 2f - 1f, 4f\n\t" \
+            ".popsection\n\t" \
+            "leaq 3b(%%rip), %[tmp]\n\t" \
+            "movq %[tmp], 8(%[rseq])\n\t" \
+            "1:\n\t" \
+            "cmpl %[cpu], 4(%[rseq])\n\t" \
+            "jnz 5f\n\t" \
+            "cmpq $0, %c[busy](%[cache])\n\t" \
+            "jnz 9f\n\t"
+#       define LFMR_RSEQ_END \
+            "2:\n\t" \
+            "movl $0, %[status]\n\t" \
+            "jmp 7f\n\t" \
+            ".byte 0x0f, 0xb9, 0x3d\n\t" \
+            ".long %c[sig]\n\t" \
+            "4:\n\t" \
+            "5:\n\t" \
+            "movl $1, %[status]\n\t" \
+            "jmp 7f\n\t" \
+            "6:\n\t" \
+            "movl $2, %[status]\n\t" \
+            "jmp 7f\n\t" \
+            "9:\n\t" \
+            "movl $3, %[status]\n\t" \
+            "7:\n\t"
+#       define LFMR_RSEQ_POP \
+            "movq (%[size]), %[value]\n\t" \
+            "testq %[value], %[value]\n\t" \
+            "jz 6f\n\t" \
+            "subq $1, %[value]\n\t" \
+            "movq %[value], %[tmp]\n\t" \
+            "movq (%[slots], %[value], 8), %[value]\n\t" \
+            "movq %[tmp], (%[size])\n\t"
+#       define LFMR_RSEQ_PUSH \
+            "movq (%[size]), %[tmp]\n\t" \
+            "cmpq %[capacity], %[tmp]\n\t" \
+            "jae 6f\n\t" \
+            "movq %[value], (%[slots], %[tmp], 8)\n\t" \
+            "addq $1, %[tmp]\n\t" \
+            "movq %[tmp], (%[size])\n\t"
+#       define LFMR_RSEQ_BUMP \
+            "movq %c[bump](%[cache]), %[value]\n\t" \
+            "testq %[value], %[value]\n\t" \
+            "jz 6f\n\t" \
+            "movq %c[end](%[cache]), %[aux]\n\t" \
+            "movq %[aux], %[tmp]\n\t" \
+            "andq $-2, %[tmp]\n\t" \
+            "subq %[value], %[tmp]\n\t" \
+            "cmpq %[bytes], %[tmp]\n\t" \
+            "jb 6f\n\t" \
+            "leaq (%[value], %[bytes]), %[tmp]\n\t" \
+            "movq %[tmp], %c[bump](%[cache])\n\t"
+#       define LFMR_RSEQ_SWAP_CHUNK \
+            "cmpq %[expected], %c[bump](%[cache])\n\t" \
+            "jnz 6f\n\t" \
+            "movq %c[end](%[cache]), %[aux]\n\t" \
+            "testq %[expected], %[expected]\n\t" \
+            "jnz 8f\n\t" \
+            "movq %[new_end], %c[end](%[cache])\n\t" \
+            "8:\n\t" \
+            "movq %[new_bump], %c[bump](%[cache])\n\t"
+#   else
+#       define LFMR_RSEQ_SIG RSEQ_SIG_CODE
+#       define LFMR_RSEQ_BEGIN \
+            ".pushsection __rseq_cs, \"aw\"\n\t" \
+            ".balign 32\n\t" \
+            "3:\n\t" \
+            ".long 0, 0\n\t" \
+            ".quad 1f, 2f - 1f, 4f\n\t" \
+            ".popsection\n\t" \
+            "adrp %[tmp], 3b\n\t" \
+            "add %[tmp], %[tmp], :lo12:3b\n\t" \
+            "str %[tmp], [%[rseq], #8]\n\t" \
+            "1:\n\t" \
+            "ldr %w[tmp], [%[rseq], #4]\n\t" \
+            "cmp %w[tmp], %w[cpu]\n\t" \
+            "b.ne 5f\n\t" \
+            "ldr %[tmp], [%[cache], #%c[busy]]\n\t" \
+            "cbnz %[tmp], 9f\n\t"
+#       define LFMR_RSEQ_END \
+            "2:\n\t" \
+            "mov %w[status], #0\n\t" \
+            "b 7f\n\t" \
+            ".inst %c[sig]\n\t" \
+            "4:\n\t" \
+            "5:\n\t" \
+            "mov %w[status], #1\n\t" \
+            "b 7f\n\t" \
+            "6:\n\t" \
+            "mov %w[status], #2\n\t" \
+            "b 7f\n\t" \
+            "9:\n\t" \
+            "mov %w[status], #3\n\t" \
+            "7:\n\t"
+#       define LFMR_RSEQ_POP \
+            "ldr %[value], [%[size]]\n\t" \
+            "cbz %[value], 6f\n\t" \
+            "sub %[tmp], %[value], #1\n\t" \
+            "ldr %[value], [%[slots], %[tmp], lsl #3]\n\t" \
+            "str %[tmp], [%[size]]\n\t"
+#       define LFMR_RSEQ_PUSH \
+            "ldr %[tmp], [%[size]]\n\t" \
+            "cmp %[tmp], %[capacity]\n\t" \
+            "b.hs 6f\n\t" \
+            "str %[value], [%[slots], %[tmp], lsl #3]\n\t" \
+            "add %[tmp], %[tmp], #1\n\t" \
+            "str %[tmp], [%[size]]\n\t"
+#       define LFMR_RSEQ_BUMP \
+            "ldr %[value], [%[cache], #%c[bump]]\n\t" \
+            "cbz %[value], 6f\n\t" \
+            "ldr %[aux], [%[cache], #%c[end]]\n\t" \
+            "and %[tmp], %[aux], #-2\n\t" \
+            "sub %[tmp], %[tmp], %[value]\n\t" \
+            "cmp %[tmp], %[bytes]\n\t" \
+            "b.lo 6f\n\t" \
+            "add %[tmp], %[value], %[bytes]\n\t" \
+            "str %[tmp], [%[cache], #%c[bump]]\n\t"
+#       define LFMR_RSEQ_SWAP_CHUNK \
+            "ldr %[tmp], [%[cache], #%c[bump]]\n\t" \
+            "cmp %[tmp], %[expected]\n\t" \
+            "b.ne 6f\n\t" \
+            "ldr %[aux], [%[cache], #%c[end]]\n\t" \
+            "cbnz %[expected], 8f\n\t" \
+            "str %[new_end], [%[cache], #%c[end]]\n\t" \
+            "8:\n\t" \
+            "str %[new_bump], [%[cache], #%c[bump]]\n\t"
+#   endif
 #endif
 
 
 //
-// Few STD implementations (e.g. GCC) do not support std::hardware_destructive_interference_size
+// Few STD implementations (e.g. GCC) do not support std::hardware_destructive_interference_size,
+// and GCC warns on using it in headers since its value may vary between compiler options
 //
-#if ( __cpp_lib_hardware_interference_size < 201603 )
+#if ( __cpp_lib_hardware_interference_size < 201603 ) || ( defined( __GNUC__ ) && !defined( __clang__ ) )
 
 #   ifdef __powerpc64__
 #       define CACHELINE_SIZE 128
@@ -87,6 +253,31 @@ namespace bits
     namespace ut { template < typename lock_free_memory_resource > struct accessor; }
 
 
+    /** Internal events reported to Policy::on_event()
+    */
+    enum class event
+    {
+        magazine_allocation,    //< allocation served by per-thread or per-CPU magazine
+        garbage_allocation,     //< allocation served by garbage
+        pool_allocation,        //< allocation served by unallocated area of pool block
+        slab_allocation,        //< allocation served by slab
+        tlab_allocation,        //< allocation served by per-thread bump chunk
+        heap_allocation,        //< allocation served by per-thread heap
+        remote_free,            //< piece of per-thread heap released by another thread than the heap owner
+        pool_grow,              //< pool grown with new virtual memory block
+        reserve_take,           //< pool grown with block from background reserve
+        large_block_map,        //< large block allocated directly in virtual space
+        large_block_unmap,      //< large block released
+        large_cache_hit,        //< large block taken from cache of released large blocks instead of being allocated
+        large_block_remap,      //< large block resized by remapping without copying
+        garbage_search_step,    //< garbage search skipped a block not fitting the request
+        pool_cas_retry,         //< allocation on pool lost CAS race for unallocated area of pool block
+        garbage_cas_retry,      //< putting of released block to garbage lost CAS race for garbage bin head
+        hazard_spin,            //< thread found pointer to be locked by another thread
+        hazard_yield            //< thread yielded after Policy::spin_limit attempts to get pointer unlocked, MUST be the last one
+    };
+
+
     /** Default policy
     */
     struct default_policy
@@ -95,6 +286,65 @@ namespace bits
         static constexpr std::size_t granularity = cache_line_size; //< desired lock_free_memory_resource granularity
         static constexpr std::size_t garbage_search_depth = 64;     //< desired depth of garbage search
         static constexpr std::size_t spin_limit = 1024;             //< desired number of spins before thread goes asleep
+        static constexpr std::size_t magazine_size = 0;             //< desired number of pieces cached per thread and size, 0 disables magazines
+        static constexpr bool cpu_caches = false;                   //< keep magazines and bump chunks per CPU instead of per thread, requires rseq area registered by glibc 2.35+
+        static constexpr bool coalescing = false;                   //< merge adjacent released blocks before growing the pool
+        static constexpr std::size_t purge_decay = 0;               //< desired idle time in ms before released memory returns to OS, 0 disables automatic purging
+        static constexpr bool lazy_purge = false;                   //< let OS reclaim purged memory lazily ( e.g. MADV_FREE ) instead of immediately
+        static constexpr bool huge_pages = false;                   //< back pool blocks and large blocks with huge pages if possible
+        static constexpr std::size_t reserve_size = 0;              //< desired size in bytes of pre-faulted pool blocks kept ready by background thread, 0 disables the thread
+        static constexpr std::size_t reserve_low_watermark = 0;     //< reserve size in bytes below which background thread replenishes the reserve, it is replenished at least if gets empty
+        static constexpr std::size_t slab_max_size = 0;             //< pieces up to the size are allocated on slabs without per-piece header, 0 disables slabs
+        static constexpr std::size_t slab_arena_size = 1 << 26;     //< size of virtual space reserved for slabs on first slab allocation
+        static constexpr std::size_t large_cache_size = 0;          //< desired total size in bytes of released large blocks kept mapped for reuse, 0 disables the cache
+        static constexpr std::size_t large_cache_decay = 0;         //< desired idle time in ms before cached large block gets unmapped, 0 keeps it till trim()
+        static constexpr bool trusted_size = false;                 //< rely on size and alignment passed to deallocate(), so pieces carry no header
+        static constexpr std::size_t tlab_size = 0;                 //< size in bytes of per-thread bump chunks carved from pool blocks, 0 disables them
+        static constexpr std::size_t heap_block_size = 0;           //< size in bytes of heap blocks owned by single thread, a power of two, 0 disables per-thread heaps
+        static constexpr std::size_t heap_arena_size = 1 << 28;     //< size of virtual space reserved for per-thread heaps on first heap allocation
+
+        static constexpr bool statistics = false;                   //< count internal events per thread, see lock_free_memory_resource::get_statistics()
+        static void on_event( event ) noexcept {}                   //< hook for internal events, e.g. to profile contention
+    };
+
+
+    /** Result of allocate_at_least()
+    */
+    struct allocation_result
+    {
+        void* ptr_ = nullptr;                           //< pointer to allocated piece
+        std::size_t count_ = 0;                         //< usable size of the piece, at least requested one
+    };
+
+
+    /** Interface of memory resources reporting usable size of allocated pieces
+
+    Every lock_free_memory_resource implements it whatever its policy is, so bits::allocate_at_least() helper finds
+    the resource behind std::pmr::polymorphic_allocator without knowing the policy
+    */
+    class at_least_capable
+    {
+    public:
+
+        /** Allocates a piece of at least requested size like C++23 std::allocator::allocate_at_least() does
+
+        @param [in] bytes - requested size
+        @param [in] alignment - requested alignment
+        @retval pointer to the piece and its usable size, the piece could be deallocated with any size between
+                requested and usable one
+        @throw std::invalid_argument if size or alignment is invalid, std::bad_alloc if memory is low
+        */
+        allocation_result allocate_at_least( std::size_t bytes, std::size_t alignment = alignof( std::max_align_t ) )
+        {
+            return do_allocate_at_least( bytes, alignment );
+        }
+
+    protected:
+
+        ~at_least_capable() = default;
+
+        /** Implements allocate_at_least() */
+        virtual allocation_result do_allocate_at_least( std::size_t bytes, std::size_t alignment ) = 0;
     };
 
 
@@ -102,18 +352,110 @@ namespace bits
 
     - deallocation is always WAIT FREE
     - allocation is LOCK FREE except the following cases:
-        - allocated pool exhausted (use initial_buffer_size to reserve required amount of memory upon construction)
+        - allocated pool exhausted (use initial_buffer_size to reserve required amount of memory upon construction,
+          or Policy::reserve_size to get the pool replenished ahead of demand)
         - requested piece exceed maximum size to be allocated on pool
     - if active defragmentation is disabled and there is only one thread allocating from the resource then
       the previous guarantee turns into WAIT FREE
 
     Implemented by two linked lists: the pool that is a number of blocks allocated in process's virtual space,
-    and garbage that is list of released memory pieces available for following allocations
+    and garbage that is list of released memory pieces available for following allocations. The garbage is split
+    into bins by block size, so a fitting released block is found without searching through the whole garbage
+
+    If Policy::magazine_size is not zero every thread additionally keeps small per-size magazines of released
+    pieces, so the most of allocations and deallocations do not touch shared garbage at all. A magazine exchanges
+    pieces with the garbage by batches when it gets full or empty, and gets flushed to the garbage on thread exit
+
+    If Policy::cpu_caches is set as well the magazines and bump chunks (see Policy::tlab_size) are kept per CPU rather
+    than per thread, so thousands of mostly idle threads do not hold cached pieces each. The CPU is taken from the
+    rseq area glibc 2.35+ registers for every thread on Linux, the area is never registered by the resource itself.
+    On x86_64 and aarch64 a magazine push or pop and a chunk bump are rseq critical sections committed by a single
+    plain store, so the fast path needs no atomic read-modify-write at all: the kernel restarts a section if the
+    thread gets preempted, signalled or migrated in the middle. trim() flushes the CPU caches to the garbage, it
+    locks the cache of every CPU by a busy flag and restarts the sections running there by rseq membarrier. Where
+    the sections or the membarrier are not available the caches are guarded by the busy flag taken as a try-lock
+    instead, which costs one atomic exchange. A thread without rseq or finding the cache of its CPU busy goes to
+    the garbage and the pool directly. If glibc has not registered rseq the magazines and chunks stay per thread
+
+    If Policy::tlab_size is not zero every thread claims a chunk of a pool block by a single CAS and carves small
+    pieces from it by bumping a plain pointer, so threads do not fight over unallocated_ of the same pool block.
+    Unused tail of the chunk goes back to the pool or to the garbage as soon as the chunk is exhausted or the thread
+    exits
+
+    If Policy::heap_block_size is not zero every thread owns heap blocks carved from a dedicated virtual range
+    reserved on first use and allocates small pieces there. Owner of the block is kept in block header found by
+    masking piece pointer: a piece released by the owner goes to owner's private free list of its size class, a piece
+    released by another thread gets pushed onto owner's remote free list by a single CAS, the owner takes the whole
+    list by a single exchange once its private list gets empty. So producer-consumer pipelines do not fight over
+    shared garbage. A private list keeps at most a heap block worth of pieces, the excess goes to the garbage. Heap
+    blocks of exited thread stay owned by its state, the pieces cached by the state go to the garbage on thread exit
+    and its remote list gets sealed, so pieces released later go to the garbage too
+
+    If Policy::coalescing is set physically adjacent released blocks get merged lazily each time the pool is about
+    to grow, a released block adjacent to unallocated area of its pool block is given back to the pool block
+
+    Physical memory of released blocks and of given back pool areas can be returned to OS explicitly by trim(), or
+    automatically on deallocation as soon as it stays unused longer than Policy::purge_decay milliseconds
+
+    If Policy::huge_pages is set pool blocks and large blocks are rounded up to huge page size and backed by huge
+    pages (hugetlbfs or transparent huge pages on Linux, large pages on Windows) if the system allows that
+
+    If Policy::large_cache_size is not zero released large blocks stay mapped in a cache bucketed by page count up
+    to the given total size, a large allocation takes a cached block of enough size and splits off the remainder,
+    so neither mapping nor page faults are paid. Cached blocks idle longer than Policy::large_cache_decay
+    milliseconds are unmapped, hits are reported as event::large_cache_hit
+
+    If Policy::slab_max_size is not zero small pieces are allocated on slabs: runs of pieces of the same size class
+    carved from a dedicated virtual range reserved on first use. A run takes a page, or the least power of two of
+    pages fitting the largest size class. Size class is kept in run header found by masking piece pointer, so the
+    pieces carry no header and get rounded up to 8 bytes (or alignment) instead of granularity
+
+    If Policy::trusted_size is set pool and large pieces carry no header (large block keeps only pointer to its
+    registry slot in front of the piece): size and alignment passed to deallocate() must be the same as passed to
+    allocate() (or up to the size reported by allocate_at_least()), the piece size is calculated from them. Debug
+    builds keep end of each piece in its trailer and assert the size passed to deallocate() leads to the same end
+
+    Request-scoped users can release() all the allocated memory at once instead of destroying the resource, pool
+    blocks get rewound and stay mapped and faulted for following allocations
+
+    Scratch memory of a phase that dies together can be reclaimed at once: checkpoint() captures position of pool
+    bump pointer and rewind() moves it back, the pieces carved from the pool after the checkpoint are gone
+
+    Alignment is not limited by system page size: over-aligned pieces fitting pool block with the worst alignment
+    gap are allocated on the pool, larger ones get mapped with alignment slack, which is given back to OS right away,
+    so 2MB or 1GB aligned tables do not need a bypass
+
+    Allocated piece can be resized in place by try_expand() or moved by reallocate(): a pool piece ending at
+    unallocated area of its pool block grows by a single CAS, a large block gets remapped (mremap on Linux) without
+    copying
+
+    allocate_at_least() reports the whole usable size of allocated piece including the slack it got rounded up
+    with, so growable buffers could use the slack instead of reallocating early, see also bits::allocate_at_least()
+    helper for std::pmr::polymorphic_allocator
+
+    allocate_zeroed() provides zero-filled piece and clears it only if the memory has been used before: never
+    allocated area of a pool block and a freshly mapped large block are zero-filled by OS, so large zeroed tables
+    neither get touched nor committed up front
+
+    Batch-oriented callers can take and give back a number of same-sized pieces at once by allocate_bulk() and
+    deallocate_bulk(), a batch takes a single span from the pool or the garbage and goes back to garbage by a single
+    CAS, so per-piece synchronization is avoided
+
+    Memory usage (committed, unallocated, released and large blocks, fragmentation) is reported by get_snapshot()
+    that is safe to be called concurrently with allocations
+
+    If Policy::statistics is set every thread counts internal events (allocations by path, garbage search steps, CAS
+    retries, hazard spins, pool grows etc.) in its own counters, get_statistics() sums them up on demand. Events of
+    threads without state (e.g. exiting ones) are counted by the resource itself
+
+    If Policy::reserve_size is not zero a background thread keeps the given amount of pre-mapped and pre-faulted pool
+    blocks ready, an exhausted pool is grown with a reserved block first, so allocating thread pays neither for
+    mapping nor for page faults
 
     @tparam Policy - set of static parameters to tune the class
     */
     template < typename Policy = default_policy >
-    class lock_free_memory_resource : public std::pmr::memory_resource
+    class lock_free_memory_resource : public std::pmr::memory_resource, public at_least_capable
     {
         // allows access to the private part
         template < typename HeapType > friend struct ut::accessor;
@@ -162,7 +504,9 @@ namespace bits
         {
             std::atomic< pointer_type > unallocated_;   //< pointer to unallocated area inside a pool block
             pointer_type next_;                         //< poniter to the next pool block
-            size_type size_;                            //< size of block
+            std::atomic< size_type > size_;             //< size of block, grows if adjacent block gets merged
+            std::atomic< pointer_type > dirty_;         //< end of given back area, which is not clean anymore, if exceeds unallocated_
+            std::atomic< pointer_type > fresh_;         //< beginning of never allocated area, which is still zero-filled
         };
 
 
@@ -171,15 +515,23 @@ namespace bits
         {
             size_type size_;                            //< size of block
             std::atomic< pointer_type > next_;          //< next block in the chain
+            std::int64_t stamp_;                        //< release time or 0 if physical memory of the block has been returned to OS
         };
 
 
         /** memory granularity or allocation quantum, minimum amount of memory taken by allocated block */
         static_assert( Policy::granularity, "Policy::granularity supposed to be positive integer" );
-        static constexpr size_type granularity_ = ceil( Policy::granularity, std::hardware_destructive_interference_size );
+        static constexpr size_type granularity_ = ceil( Policy::granularity, cache_line_size );
 
         /** Cummulative size of internal fields of allocated memory block */
-        static constexpr size_type piece_internal_fields_size_ = sizeof( size_type ) + sizeof( pointer_type );
+        static constexpr size_type piece_internal_fields_size_ = Policy::trusted_size ? 0 : sizeof( size_type ) + sizeof( pointer_type );
+
+        /** Size of allocated memory block trailer keeping end of the block to cross-check size passed on deallocation */
+#ifdef NDEBUG
+        static constexpr size_type piece_trailer_size_ = 0;
+#else
+        static constexpr size_type piece_trailer_size_ = Policy::trusted_size ? sizeof( size_type ) : 0;
+#endif
 
         /** Size of pool block header */
         static constexpr size_type pool_block_header_size_ = ceil( sizeof( pool_block_header ), granularity_ );
@@ -187,14 +539,273 @@ namespace bits
         /** Size of released block header */
         static constexpr size_type garbage_block_header_size = sizeof( garbage_block_header );
 
+        /** Number of garbage bins holding blocks of exact size, i-th bin holds blocks of ( i + 1 ) * granularity_ bytes */
+        static constexpr size_type garbage_exact_bin_count_ = 16;
+
+        /** Log2 of number of garbage bins each power of two above exact bins is split into */
+        static constexpr size_type garbage_bin_split_order_ = 2;
+
+
+        /** Provides index of garbage bin for a block of given size
+
+        Small blocks get own bin per size, larger ones are distributed between geometric bins each covering a quarter
+        of a power of two
+
+        @param [in] size - block size ( MUST be a multiple of granularity_ )
+        @retval index of garbage bin
+        @throw never
+        */
+        static constexpr size_type garbage_bin_index( size_type size ) noexcept
+        {
+            assert( size > 0 && size % granularity_ == 0 );
+            auto granules = size / granularity_;
+            if ( granules <= garbage_exact_bin_count_ ) return granules - 1;
+
+            size_type order = 0;
+            for ( auto value = granules - 1; value >>= 1; ++order );
+
+            size_type exact_order = 0;
+            for ( auto value = garbage_exact_bin_count_; value >>= 1; ++exact_order );
+
+            auto sub_bin = ( ( granules - 1 ) >> ( order - garbage_bin_split_order_ ) ) & ( ( 1 << garbage_bin_split_order_ ) - 1 );
+            return garbage_exact_bin_count_ + ( ( order - exact_order ) << garbage_bin_split_order_ ) + sub_bin;
+        }
+
+
+        /** Number of garbage bins, the last one also keeps all blocks exceeding desired pool block size */
+        static constexpr size_type garbage_bin_count_ = garbage_bin_index( ceil( Policy::block_size, granularity_ ) ) + 1;
+
+
+        /** Garbage size class table: maximum size of block kept by each bin */
+        static constexpr auto garbage_bin_limits_ = []() {
+            std::array< size_type, garbage_bin_count_ > limits = {};
+            for ( size_type size = granularity_, bin = 0; bin < garbage_bin_count_; size += granularity_ )
+            {
+                if ( garbage_bin_index( size + granularity_ ) != bin ) limits[ bin++ ] = size;
+            }
+            return limits;
+        }();
+
+
+        /** Slab size classes are multiples of the quantum */
+        static constexpr size_type slab_quantum_ = 8;
+        static_assert( Policy::slab_max_size % slab_quantum_ == 0, "Policy::slab_max_size supposed to be multiple of 8" );
+
+
+        /** Number of slab size classes, i-th class holds pieces of ( i + 1 ) * slab_quantum_ bytes */
+        static constexpr size_type slab_class_count_ = Policy::slab_max_size / slab_quantum_;
+
+
+        /** Holds slab run internal fields, padded to cache line so the pieces of the run are aligned with it */
+        struct alignas( cache_line_size ) slab_run_header
+        {
+            size_type size_;                            //< size of pieces in the run
+        };
+
+
+        /** Released pieces of a slab size class, occupies whole cache line to avoid false sharing between classes */
+        struct alignas( cache_line_size ) slab_class
+        {
+            std::atomic< pointer_type > head_ = 0;      //< pointer to the first released piece, the piece keeps pointer to the next one
+        };
+
+
+        /** Garbage bin head, occupies whole cache line to avoid false sharing between bins */
+        struct alignas( cache_line_size ) garbage_bin
+        {
+            std::atomic< pointer_type > head_ = 0;      //< pointer to the first block of the bin
+        };
+
+
+        /** Virtual range reserved on first use and carved into runs or heap blocks */
+        struct arena
+        {
+            std::atomic< pointer_type > begin_ = 0;     //< reserved range or 0 if it is not reserved yet
+            std::atomic< size_type > unallocated_ = 0;  //< offset of the part of the range not carved yet
+        };
+
+
+        /** Number of words in the bitmap of non-empty garbage bins */
+        static constexpr size_type garbage_bitmap_size_ = ( garbage_bin_count_ + 63 ) / 64;
+
+        /** Number of per-thread magazines, i-th magazine caches blocks of ( i + 1 ) * granularity_ bytes, so the one of i-th garbage bin */
+        static constexpr size_type magazine_count_ = Policy::magazine_size ? std::min< size_type >( 8, garbage_exact_bin_count_ ) : 0;
+
+        /** Number of blocks a magazine takes from garbage at once */
+        static constexpr std::size_t magazine_batch_ = Policy::magazine_size / 2 ? Policy::magazine_size / 2 : 1;
+
+        /** Desired size of per-thread bump chunk, 0 if the chunks are disabled */
+        static constexpr size_type tlab_size_ = ceil( static_cast< size_type >( Policy::tlab_size ), granularity_ );
+
+        /** Size of per-thread heap block */
+        static constexpr size_type heap_block_size_ = static_cast< size_type >( Policy::heap_block_size );
+        static_assert( ( heap_block_size_ & ( heap_block_size_ - 1 ) ) == 0, "Policy::heap_block_size supposed to be a power of two" );
+
+        /** Number of per-thread heap size classes, i-th class holds blocks of ( i + 1 ) * granularity_ bytes, 0 if the heaps are disabled */
+        static constexpr size_type heap_class_count_ = std::min< size_type >( 64, heap_block_size_ / 8 / granularity_ );
+
+
+        /** Number of internal event types */
+        static constexpr std::size_t event_count_ = static_cast< std::size_t >( event::hazard_yield ) + 1;
+
+
+        /** Holds data of a thread working with the resource */
+        struct thread_state
+        {
+            std::atomic< pointer_type > owner_;                         //< owning resource or 0 if either thread or resource is gone
+            thread_state* next_ = nullptr;                              //< next state in the resource's registry
+            thread_state* thread_next_ = nullptr;                       //< next state of the same thread
+            pointer_type magazines_[ magazine_count_ ? magazine_count_ : 1 ] = {};     //< cached block chains
+            pointer_type magazine_tails_[ magazine_count_ ? magazine_count_ : 1 ] = {}; //< last blocks of the chains
+            std::size_t magazine_sizes_[ magazine_count_ ? magazine_count_ : 1 ] = {};  //< number of blocks in the chains
+            std::atomic< std::uint64_t > counters_[ Policy::statistics ? event_count_ : 1 ] = {};   //< internal events of the thread
+            pointer_type tlab_ = 0;                                     //< bump pointer inside claimed chunk
+            pointer_type tlab_end_ = 0;                                 //< end of claimed chunk
+            bool tlab_fresh_ = false;                                   //< the chunk has never been allocated before, so it is zero-filled
+            pointer_type heap_ = 0;                                     //< bump pointer inside owned heap block
+            pointer_type heap_limit_ = 0;                               //< end of owned heap block
+            pointer_type heap_frees_[ heap_class_count_ ? heap_class_count_ : 1 ] = {};    //< heap pieces released by the thread by size class
+            size_type heap_free_counts_[ heap_class_count_ ? heap_class_count_ : 1 ] = {}; //< number of pieces in the private lists
+            std::atomic< pointer_type > remote_frees_ = 0;              //< heap pieces released by other threads or sealed_ if the thread is gone
+
+            explicit thread_state( pointer_type owner ) noexcept : owner_( owner ) {}
+        };
+
+
+        /** Keeps states of current thread and detaches them on thread exit */
+        struct thread_hook
+        {
+            thread_state* states_ = nullptr;                            //< states of the thread
+            bool alive_ = true;                                         //< false as soon as the thread is exiting
+
+            ~thread_hook()
+            {
+                alive_ = false;
+                while ( states_ )
+                {
+                    auto state = states_;
+                    states_ = state->thread_next_;
+
+                    // lock the state to prevent owning resource from being destroyed meanwhile
+                    auto owner = wait_till_hazarded( [&]() noexcept {
+                        return state->owner_.fetch_or( hazard_, std::memory_order_acq_rel ); }
+                    );
+
+                    if ( owner )
+                    {
+                        // return cached memory to the resource and leave the state in its registry for reuse
+                        reinterpret_cast< lock_free_memory_resource* >( owner )->flush_magazines( *state );
+                        reinterpret_cast< lock_free_memory_resource* >( owner )->retire_tlab( *state );
+                        reinterpret_cast< lock_free_memory_resource* >( owner )->flush_heap( *state );
+                        state->owner_.store( 0, std::memory_order_release );
+                    }
+                    else
+                    {
+                        // the resource is gone, nobody else refers the state
+                        delete state;
+                    }
+                }
+            }
+        };
+
+        /** Holds magazines and bump chunk shared by threads running on the same CPU
+
+        The fields are modified by rseq critical sections, or under busy_ flag taken as a try-lock if rseq is not
+        available. Layout of the first three fields is relied on by the critical sections
+        */
+        struct alignas( cache_line_size ) cpu_cache
+        {
+            std::atomic< pointer_type > busy_ = 0;                      //< a thread is working with the cache outside of critical sections
+            std::atomic< pointer_type > bump_ = 0;                      //< bump pointer inside the CPU's chunk, 0 if there is no chunk
+            std::atomic< pointer_type > bump_end_ = 0;                  //< end of the chunk, the lowest bit is set if the chunk is zero-filled
+            std::atomic< size_type > magazine_sizes_[ magazine_count_ ? magazine_count_ : 1 ] = {};    //< number of blocks in the magazines
+            pointer_type magazines_[ magazine_count_ ? magazine_count_ : 1 ][ Policy::magazine_size ? Policy::magazine_size : 1 ] = {}; //< cached blocks
+        };
+
+
+        /** Outcome of an operation on CPU cache */
+        enum cpu_status : int
+        {
+            cpu_done = 0,                               //< the operation has been committed
+            cpu_retry = 1,                              //< the critical section has been aborted, e.g. the thread has migrated
+            cpu_failed = 2,                             //< the cache cannot serve the operation, e.g. the magazine is empty
+            cpu_busy = 3                                //< the cache is locked by another thread or rseq is not available
+        };
+
+
+        /** Holds per-thread heap block internal fields, padded to cache line */
+        struct alignas( cache_line_size ) heap_block_header
+        {
+            thread_state* owner_;                       //< state of the thread owning the block
+        };
+
+
+        /** Size of per-thread heap block header with respect to granularity */
+        static constexpr size_type heap_block_header_size_ = ceil( static_cast< size_type >( sizeof( heap_block_header ) ), granularity_ );
+
+
+        /** Number of large blocks tracked by a chunk of large block registry */
+        static constexpr size_type large_block_registry_chunk_size_ = 63;
+
+
+        /** Chunk of registry of allocated large blocks, chunks are never removed till the resource is gone
+
+        Every large block keeps pointer to its slot in the header, free slots are chained, so neither registering nor
+        unregistering of a block walks the registry
+        */
+        struct large_block_registry_chunk
+        {
+            struct slot
+            {
+                std::atomic< pointer_type > block_ = 0;     //< allocated large block or 0 if the slot is free
+                size_type size_ = 0;                        //< size of the block
+                pointer_type next_free_ = 0;                //< next free slot
+            };
+
+            slot slots_[ large_block_registry_chunk_size_ ];        //< tracked blocks
+            large_block_registry_chunk* next_ = nullptr;            //< next chunk
+        };
+
+
+        /** Number of buckets of large block cache, i-th bucket keeps blocks of [ 2^i, 2^( i + 1 ) ) pages */
+        static constexpr size_type large_cache_bucket_count_ = Policy::large_cache_size ? 48 : 0;
+
+
         /** Hazard bit in unused part of pointer value, signals that hazarded pointer is locked by another thread */
         static constexpr pointer_type hazard_ = 1;
 
 
+        /** Remote free list value of exited thread, signals that pieces have to go to the garbage */
+        static constexpr pointer_type sealed_ = 1;
+
+
         // data members 
         std::atomic< pointer_type > pool_ = 0;      //< pointer to the first pool block
-        std::atomic< pointer_type > garbage_ = 0;   //< pointer to the first deallocated block
-        std::condition_variable grow_cv_;           //< pool grow complete notifier
+        garbage_bin garbage_[ garbage_bin_count_ ];                         //< deallocated blocks by size
+        std::atomic< std::uint64_t > garbage_bitmap_[ garbage_bitmap_size_ ] = {};  //< bitmap of non-empty garbage bins
+        std::atomic< thread_state* > threads_ = nullptr;    //< registry of thread states
+        std::atomic< std::uint64_t > counters_[ Policy::statistics ? event_count_ : 1 ] = {};  //< internal events raised by threads without state
+        std::atomic< bool > maintenance_ = false;           //< garbage is being coalesced or purged
+        std::atomic< std::int64_t > next_purge_ = 0;        //< time of the next automatic purging
+        std::atomic< pointer_type > reserve_ = 0;           //< pre-faulted pool blocks ready to be put to the pool
+        std::atomic< size_type > reserve_bytes_ = 0;        //< total size of reserved pool blocks
+        std::atomic< size_type > large_bytes_ = 0;          //< total size of allocated large blocks
+        std::atomic< size_type > large_count_ = 0;          //< number of allocated large blocks
+        std::atomic< large_block_registry_chunk* > large_blocks_ = nullptr;     //< registry of allocated large blocks
+        std::atomic< pointer_type > large_block_free_slots_ = 0;            //< free slots of large block registry
+        garbage_bin large_cache_[ large_cache_bucket_count_ ? large_cache_bucket_count_ : 1 ];     //< released large blocks by page count
+        std::atomic< size_type > large_cache_bytes_ = 0;    //< total size of cached large blocks
+        std::atomic< std::int64_t > next_large_cache_trim_ = 0;     //< time of the next automatic unmapping of idle cached blocks
+        slab_class slabs_[ slab_class_count_ ? slab_class_count_ : 1 ];     //< released slab pieces by size class
+        arena slab_arena_;                                  //< virtual range reserved for slabs
+        arena heap_arena_;                                  //< virtual range reserved for per-thread heaps
+        cpu_cache* cpu_caches_ = nullptr;                   //< per-CPU magazines and chunks
+        size_type cpu_cache_count_ = 0;                     //< number of per-CPU caches, one per possible CPU
+        bool cpu_fence_ = false;                            //< the caches are modified by rseq critical sections, so taking busy_ flag needs CPU fence
+        std::atomic< bool > replenisher_stop_ = false;      //< signals background replenisher to exit
+        std::mutex replenisher_mutex_;                      //< guards waiting of background replenisher
+        std::condition_variable replenisher_cv_;            //< wakes background replenisher up
+        std::thread replenisher_;                           //< background replenisher
 
 
         /** Cycles given action till returned value statys hazarded (the lowest bit is signalled)
@@ -202,18 +813,22 @@ namespace bits
         If number of cycles exceeds the limit force current thread to yeild
 
         @param [in] action - action to be cycled
+        @param [in] resource - resource to count spins and yields by, if any
         @retval first non-hazarded result of the action
         @throw whatever action throws
         */
         template < typename ActionType >
-        auto wait_till_hazarded( ActionType&& action )
+        static auto wait_till_hazarded( ActionType&& action, lock_free_memory_resource* resource = nullptr )
         {
+            auto notify = [ resource ]( event e ) noexcept { resource ? resource->notify( e ) : Policy::on_event( e ); };
             while ( true )
             {
                 for ( std::size_t spin = 0; spin < Policy::spin_limit; ++spin )
                 {
                     if ( auto value = action(); ( value & hazard_ ) == 0 ) return value;
+                    notify( event::hazard_spin );
                 }
+                notify( event::hazard_yield );
                 std::this_thread::yield();
             }
         }
@@ -239,6 +854,55 @@ namespace bits
         }
 
 
+        /** Provides huge page size supported by target OS
+
+        @retval huge page size or 0 if huge pages are not supported
+        @throw never
+        */
+        static size_type huge_page_size() noexcept
+        {
+#ifdef _WIN32
+            static const size_type sz = static_cast< size_type >( ::GetLargePageMinimum() );
+#elif defined( __linux__ )
+            static const size_type sz = []() noexcept {
+                size_type kb = 2048;
+                if ( auto meminfo = std::fopen( "/proc/meminfo", "r" ) )
+                {
+                    char line[ 128 ];
+                    while ( std::fgets( line, sizeof( line ), meminfo ) )
+                    {
+                        unsigned long value = 0;
+                        if ( std::sscanf( line, "Hugepagesize: %lu kB", &value ) == 1 ) { kb = value; break; }
+                    }
+                    std::fclose( meminfo );
+                }
+                return kb * 1024;
+            }( );
+#else
+            static const size_type sz = 0;
+#endif
+            return sz;
+        }
+
+
+        /** Rounds size of virtual memory block up to allocation quantum
+
+        Blocks of huge page size and larger are rounded up to huge page size if Policy::huge_pages is set
+
+        @param [in] size - desired size of virtual memory block
+        @retval actual size of virtual memory block
+        @throw never
+        */
+        static size_type virtual_block_size( size_type size ) noexcept
+        {
+            if constexpr ( Policy::huge_pages )
+            {
+                if ( auto huge = huge_page_size(); huge > system_page_size() && size >= huge ) return ceil( size, huge );
+            }
+            return ceil( size, system_page_size() );
+        }
+
+
         /** Provides actual pool block size with respect to desired value and target system capabilities
         
         @param [in] desired - desired pool block size
@@ -248,7 +912,7 @@ namespace bits
         static size_type pool_block_size( size_type desired_size = 0 ) noexcept
         {
             static_assert( Policy::block_size, "Policy::block_size supposed to be positive integer" );
-            static size_type value = ceil( desired_size ? desired_size : Policy::block_size, system_page_size() );
+            static size_type value = virtual_block_size( desired_size ? desired_size : Policy::block_size );
             return value;
         };
 
@@ -272,17 +936,110 @@ namespace bits
         */
         static void* virtual_alloc( size_type size, void* desire = nullptr )
         {
+            if constexpr ( Policy::huge_pages )
+            {
+                if ( auto block = virtual_alloc_huge( size, desire ) ) return block;
+            }
+
 #ifdef _WIN32
             auto block = ::VirtualAlloc( desire, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE );
             if ( !block ) throw std::bad_alloc();
 #else
-            auto block = ::mmap( desire, size, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_SHARED, -1, 0 );
+            auto block = ::mmap( desire, size, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0 );
             if ( MAP_FAILED == block ) throw std::bad_alloc();
 #endif
             return block;
         }
 
 
+        /** Allocates virtual memory block backed by huge pages
+
+        Tries explicit huge pages first, then transparent huge pages over a block aligned with huge page size
+
+        @param [in] size - size of requested memory block
+        @param [in] desire - desired placement of the block
+        @retval allocated block or nullptr if huge pages are not available for the block
+        @throw never
+        */
+        static void* virtual_alloc_huge( size_type size, [[maybe_unused]] void* desire ) noexcept
+        {
+            auto huge = huge_page_size();
+            if ( huge <= system_page_size() || size % huge ) return nullptr;
+
+#ifdef _WIN32
+            return ::VirtualAlloc( desire, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE );
+#else
+#   ifdef MAP_HUGETLB
+            if ( auto block = ::mmap( desire, size, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE | MAP_HUGETLB, -1, 0 ); MAP_FAILED != block ) return block;
+#   endif
+#   ifdef MADV_HUGEPAGE
+            // reserve one more huge page to align the block
+            auto reserved = ::mmap( nullptr, size + huge, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0 );
+            if ( MAP_FAILED == reserved ) return nullptr;
+
+            // and give unaligned head and tail back
+            auto head = reinterpret_cast< pointer_type >( reserved );
+            auto block = ceil( head, huge );
+            if ( block > head ) ::munmap( reserved, block - head );
+            if ( head + huge > block ) ::munmap( reinterpret_cast< void* >( block + size ), head + huge - block );
+
+            ::madvise( reinterpret_cast< void* >( block ), size, MADV_HUGEPAGE );
+            return reinterpret_cast< void* >( block );
+#   else
+            return nullptr;
+#   endif
+#endif
+        }
+
+
+        /** Allocates virtual memory block placed so that given offset inside it is aligned with given alignment
+
+        Reserves the block together with alignment slack and gives unaligned head and tail back to OS, on Windows
+        the slack reservation gets released and the aligned range is reserved again
+
+        @param [in] size - size of requested memory block
+        @param [in] alignment - required alignment, a power of two exceeding system page size
+        @param [in] offset - offset to be aligned, a multiple of system page size
+        @retval allocated block
+        @throw std::bad_alloc on failture
+        */
+        static void* virtual_alloc_aligned( size_type size, size_type alignment, size_type offset )
+        {
+            auto reserved_size = size + alignment - system_page_size();
+            if ( reserved_size < size ) throw std::bad_alloc();
+
+#ifdef _WIN32
+            while ( true )
+            {
+                auto reserved = ::VirtualAlloc( nullptr, reserved_size, MEM_RESERVE, PAGE_NOACCESS );
+                if ( !reserved ) throw std::bad_alloc();
+                auto block = ceil( reinterpret_cast< pointer_type >( reserved ) + offset, alignment ) - offset;
+                ::VirtualFree( reserved, 0, MEM_RELEASE );
+
+                // another thread could take the range meanwhile, then try again
+                if ( auto allocated = ::VirtualAlloc( reinterpret_cast< void* >( block ), size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE ) ) return allocated;
+            }
+#else
+            auto reserved = ::mmap( nullptr, reserved_size, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0 );
+            if ( MAP_FAILED == reserved ) throw std::bad_alloc();
+
+            // give unaligned head and tail back
+            auto head = reinterpret_cast< pointer_type >( reserved );
+            auto block = ceil( head + offset, alignment ) - offset;
+            if ( block > head ) ::munmap( reserved, block - head );
+            if ( head + reserved_size > block + size ) ::munmap( reinterpret_cast< void* >( block + size ), head + reserved_size - block - size );
+
+#   ifdef MADV_HUGEPAGE
+            if constexpr ( Policy::huge_pages )
+            {
+                if ( alignment >= huge_page_size() ) ::madvise( reinterpret_cast< void* >( block ), size, MADV_HUGEPAGE );
+            }
+#   endif
+            return reinterpret_cast< void* >( block );
+#endif
+        }
+
+
         /** Releases allocated block of virtual memory
 
         @param
@@ -298,6 +1055,50 @@ namespace bits
         }
 
 
+        /** Returns physical memory of given virtual memory region to OS, the region stays available for use
+
+        @param [in] p - region, MUST be aligned with system page size
+        @param [in] size - size of the region, MUST be a multiple of system page size
+        @throw never
+        */
+        static void virtual_purge( void* p, size_type size ) noexcept
+        {
+#ifdef _WIN32
+            if constexpr ( Policy::lazy_purge )
+            {
+                ::VirtualAlloc( p, size, MEM_RESET, PAGE_READWRITE );
+            }
+            else
+            {
+                ::VirtualFree( p, size, MEM_DECOMMIT );
+                ::VirtualAlloc( p, size, MEM_COMMIT, PAGE_READWRITE );
+            }
+#elif defined( MADV_FREE )
+            ::madvise( p, size, Policy::lazy_purge ? MADV_FREE : MADV_DONTNEED );
+#else
+            ::madvise( p, size, MADV_DONTNEED );
+#endif
+        }
+
+
+        /** Provides time stamp for released blocks
+
+        @retval current time in std::chrono::steady_clock ticks, or 1 if automatic purging is disabled
+        @throw never
+        */
+        static std::int64_t release_stamp() noexcept
+        {
+            if constexpr ( Policy::purge_decay > 0 )
+            {
+                return static_cast< std::int64_t >( std::chrono::steady_clock::now().time_since_epoch().count() );
+            }
+            else
+            {
+                return 1;
+            }
+        }
+
+
         /** Provides reference to block head pointer for given allocated piece
 
         @param [in] piece - allocate memory piece
@@ -312,374 +1113,3699 @@ namespace bits
         }
 
 
-        /** Allocates large memory block directly in process's virtual space not in the lock_free_memory_resource
+        /** Stores end of allocated memory block in its trailer if Policy::trusted_size is set in debug build
 
-        @param [in] bytes - requested block size
-        @param [in] alignment - requested block alignment
-        @retval pointer to aligned memory region
-        @throw std::bad_alloc on failture
+        @param [in] tile - end of the block
+        @throw never
         */
-        void* allocate_large_block( std::size_t bytes, std::size_t alignment )
+        static void set_piece_trailer( [[maybe_unused]] pointer_type tile ) noexcept
         {
-            // calculate required size
-            size_type sz = ceil( ceil( piece_internal_fields_size_, alignment ) + bytes, system_page_size() );
-
-            // allocate memory
-            auto block = reinterpret_cast< pointer_type >( virtual_alloc( sz ) );
+            if constexpr ( piece_trailer_size_ > 0 ) *reinterpret_cast< pointer_type* >( tile - piece_trailer_size_ ) = tile;
+        }
 
-            // fill out block size
-            *reinterpret_cast< size_type* >( block ) = sz;
 
-            // find aligned region 
-            auto aligned_area = ceil( block + piece_internal_fields_size_, alignment );
+        /** Checks trailer of allocated memory block
 
-            // fill out block pointer
-            get_block_header_ptr_ref( aligned_area ) = block;
+        Any size leading to the same end of the block is fine, a wrong one makes the trailer be looked for elsewhere
 
-            // return pointer to aligned region as the result
-            return reinterpret_cast< void* >( aligned_area );
+        @param [in] tile - end of the block calculated from size passed to deallocate()
+        @retval false if the block has trailer and it keeps another end
+        @throw never
+        */
+        static bool check_piece_trailer( [[maybe_unused]] pointer_type tile ) noexcept
+        {
+            if constexpr ( piece_trailer_size_ > 0 ) return *reinterpret_cast< pointer_type* >( tile - piece_trailer_size_ ) == tile;
+            return true;
         }
 
 
-        /** Allocates and prepends another pool block
+        /** Calculates size of pool block that could fit requested piece
 
-        @throw std::bad_alloc on failture
+        @param [in] bytes - requested size
+        @param [in] alignment - requested alignment
+        @retval required size of pool block, negative on overflow
+        @throw never
         */
-        void grow_pool( std::size_t desired_size = 0 )
+        static size_type required_pool_block_size( std::size_t bytes, std::size_t alignment ) noexcept
         {
-            // try lock pool for growing
-            if ( auto pool = pool_.fetch_or( hazard_, std::memory_order_acq_rel ); ( pool & hazard_ ) == 0 )
+            if ( static_cast< size_type >( alignment ) > system_page_size() )
             {
-                // determine desired placement of new block right after the top pool block
-                void* desired = pool ? reinterpret_cast< void* >( pool + reinterpret_cast< pool_block_header* >( pool )->size_ ) : nullptr;
+                // pool block is aligned with page size only, so the worst alignment gap has to fit too
+                auto gap = static_cast< size_type >( alignment ) - system_page_size();
+                return ceil( ceil( pool_block_header_size_ + piece_internal_fields_size_, system_page_size() ) + gap + bytes + piece_trailer_size_, granularity_ );
+            }
+            return ceil( ceil( pool_block_header_size_ + piece_internal_fields_size_, alignment ) + bytes + piece_trailer_size_, granularity_ );
+        }
 
-                // allocate new pool block
-                auto size = pool_block_size( desired_size );
-                if ( auto allocated = virtual_alloc( size );  allocated == desired )
-                {
-                    // if new block allocated right after the top pool block just modify size of the top pool block
-                    reinterpret_cast< pool_block_header* >( pool )->size_ += size;
 
-                    // and unlock the pool
-                    pool_.store( pool, std::memory_order_release );
-                }
-                else
-                {
-                    // mark up new pool block header
-                    auto& header = *reinterpret_cast< pool_block_header* >( allocated );
-                    header.next_ = pool & ~hazard_;
-                    header.unallocated_.store( ceil( reinterpret_cast< pointer_type >( allocated ) + sizeof( pool_block_header ), granularity_ ), std::memory_order_relaxed );
-                    header.size_ = size;
+        /** Offset of pointer to registry slot inside large block, the slot pointer follows block size field if any */
+        static constexpr size_type large_block_slot_offset_ = Policy::trusted_size ? 0 : sizeof( size_type );
 
-                    // and put new block on top of the pool
-                    pool_.store( reinterpret_cast< pointer_type >( allocated ), std::memory_order_release );
-                }
 
-                // notify waiting threads that pool growing completed
-                grow_cv_.notify_all();
-            }
-            else
-            {
-                // allocation of new pool block is expansive operation, so just put current thread asleep until growing will have completed
-                std::mutex fake_mutex;
-                std::unique_lock< std::mutex > fake_lock( fake_mutex );
-                grow_cv_.wait( fake_lock );
-            }
-        }
-
-
-        /** Allocates a region of specified size and alignment on the pool
-        
-        If there is not a pool block grows with unallocated area large enough - grows the pool with new block
+        /** Provides reference to registry slot pointer of large block
 
-        @param [in] bytes - size of requested region in bytes
-        @param [in] alignment - alignment of requested region
-        @retval pointer to aligned region of specified size
-        @throws std::bad_alloc on failture
+        @param [in] block - large block
+        @retval reference to the slot pointer
+        @throw never
         */
-        void* allocate_on_pool( std::size_t bytes, std::size_t alignment )
+        static typename large_block_registry_chunk::slot*& get_large_block_slot_ref( pointer_type block ) noexcept
         {
-            // get current pool pointer
-            auto current_pool = pool_.load( std::memory_order_acquire ) & ~hazard_;
+            assert( block );
+            return *reinterpret_cast< typename large_block_registry_chunk::slot** >( block + large_block_slot_offset_ );
+        }
 
-            while ( true )
-            {
-                // search through pool blocks
-                auto current_pool_block = current_pool;
-                while ( current_pool_block )
-                {
-                    // get pool block header
-                    assert( current_pool_block % std::alignment_of_v< pool_block_header > == 0 );
-                    auto& header = *reinterpret_cast< pool_block_header* >( current_pool_block );
 
-                    while ( true )
-                    {
-                        // get current pointer to unallocated area inside current block pool
-                        auto unallocated = header.unallocated_.load( std::memory_order_acquire );
-                        assert( unallocated % granularity_ == 0 );
+        /** Calculates offset of the piece inside its large block
 
-                        // get aligned pointer with respect to block's fields
-                        auto aligned_area = ceil( unallocated + sizeof( size_type ) + sizeof( pointer_type ), alignment );
+        Large block header keeps pointer to registry slot in addition to piece internal fields. Block of alignment
+        exceeding system page size gets mapped so that the piece follows the page keeping the header, see
+        virtual_alloc_aligned()
 
-                        // calculate end of the block
-                        auto tile = ceil( aligned_area + bytes, granularity_ );
+        @param [in] alignment - requested alignment
+        @retval offset of the piece
+        @throw never
+        */
+        static size_type large_piece_offset( std::size_t alignment ) noexcept
+        {
+            return ceil( piece_internal_fields_size_ + sizeof( pointer_type ), std::min( static_cast< size_type >( alignment ), system_page_size() ) );
+        }
 
-                        // if pool block has NOT enough unallocated space
-                        if ( tile > current_pool_block + header.size_ ) break;
 
-                        // try allocate required memory block from current pool block
-                        if ( header.unallocated_.compare_exchange_weak( unallocated, tile, std::memory_order_acq_rel, std::memory_order_relaxed ) )
-                        {
-                            // gotcha! -> fill block size field
-                            *reinterpret_cast< size_type* >( unallocated ) = static_cast< size_type >( tile - unallocated );
+        /** Calculates size of large block keeping requested piece
 
-                            // fill block head pointer
-                            get_block_header_ptr_ref( aligned_area ) = unallocated;
+        Blocks of alignment exceeding system page size are not smaller than pool block, so that the size kept in
+        the header still tells them from pool pieces
 
-                            // return pointer to aligned region as the result
-                            return reinterpret_cast< void* >( aligned_area );
-                        }
+        @param [in] bytes - requested size
+        @param [in] alignment - requested alignment
+        @retval size of virtual memory block
+        @throw never
+        */
+        static size_type large_block_size( std::size_t bytes, std::size_t alignment ) noexcept
+        {
+            auto size = large_piece_offset( alignment ) + static_cast< size_type >( bytes ) + piece_trailer_size_;
+            if ( static_cast< size_type >( alignment ) > system_page_size() ) size = std::max( size, pool_block_size() );
+            return virtual_block_size( size );
+        }
 
-                        // another thread outrun this one -> try again on current pool block
-                    }
 
-                    // current block does not have enough space -> proceed to the next one
-                    current_pool_block = reinterpret_cast< pool_block_header* >( current_pool_block )->next_;
-                }
+        /** Puts the gap left in front of aligned piece to garbage
 
-                // get pool pointer
-                auto new_pool = pool_.load( std::memory_order_acquire ) & ~hazard_;
+        @param [in] block - beginning of the gap
+        @param [in] size - size of the gap
+        @throw never
+        */
+        void put_gap_to_garbage( pointer_type block, size_type size ) noexcept
+        {
+            auto& header = *reinterpret_cast< garbage_block_header* >( block );
+            header.size_ = size;
+            header.stamp_ = release_stamp();
+            put_to_garbage( block );
+        }
 
-                // if just received value is not equal to current pool pointer -> somebody else has already grown the pool
-                if ( new_pool != current_pool )
-                {
-                    // repeat with new pool pointer
-                    current_pool = new_pool;
-                    continue;
-                }
 
-                // if there is not pool block capable to fit requested block - grow the pool
-                grow_pool();
+        /** Prepends a chain of released pieces to slab size class
+
+        @param [in] cls - size class
+        @param [in] first - first piece of the chain
+        @param [in] last - last piece of the chain
+        @throw never
+        */
+        void put_to_slab( slab_class& cls, pointer_type first, pointer_type last ) noexcept
+        {
+            while ( true )
+            {
+                // wait till class head gets unlocked, CAS fails if somebody locks it meanwhile
+                auto head = wait_till_hazarded( [&]() noexcept {
+                    return cls.head_.load( std::memory_order_acquire ); }, this
+                );
+                *reinterpret_cast< pointer_type* >( last ) = head;
+                if ( cls.head_.compare_exchange_weak( head, first, std::memory_order_acq_rel, std::memory_order_relaxed ) ) break;
+                notify( event::garbage_cas_retry );
             }
         }
 
 
-        /** Tries to allocate a region of requested size and alignment from garbage
+        /** Provides size of slab run, runs are aligned with their size
+        
+        @retval system page size or the least power of two of pages fitting run header and a piece of the largest size class
+        @throw never
         */
-        void* allocate_on_garbage( std::size_t bytes, std::size_t alignment ) noexcept
+        static size_type slab_run_size() noexcept
         {
-            static_assert( Policy::garbage_search_depth, "Policy::garbage_search_depth supposed to be positive integer" );
-
-            std::size_t garbage_search_depth = 0;
+            static const size_type value = []() noexcept {
+                auto size = system_page_size();
+                while ( size < static_cast< size_type >( sizeof( slab_run_header ) + Policy::slab_max_size ) ) size <<= 1;
+                return size;
+            }();
+            return value;
+        }
 
-            // use this->garbage_ as current garbage block an lock it
-            auto current_garbage_block_ref = std::ref( garbage_ );
-            auto current_garbage_block = wait_till_hazarded( [&]() {
-                return current_garbage_block_ref.get().fetch_or( hazard_, std::memory_order_acq_rel ); }
-            );
 
-            while ( true )
-            {
-                // nothing left to search through
-                if ( !current_garbage_block )
-                {
-                    // unlock current garbage block and leave
-                    current_garbage_block_ref.get().store( current_garbage_block, std::memory_order_release );
-                    return nullptr;
-                }
+        /** Provides size of virtual range reserved for slabs
 
-                // get reference to the next garbage block pointer
-                auto next_garbage_block_ref = std::ref( reinterpret_cast< garbage_block_header* >( current_garbage_block )->next_ );
+        @retval Policy::slab_arena_size rounded up to slab run size
+        @throw never
+        */
+        static size_type slab_arena_size() noexcept
+        {
+            static const size_type value = ceil( virtual_block_size( Policy::slab_arena_size ), slab_run_size() );
+            return value;
+        }
 
-                // get current garbage block tile
-                auto current_garbage_block_tile = current_garbage_block + reinterpret_cast< garbage_block_header* >( current_garbage_block )->size_;
 
-                // calculate aligned region placement and tile of requested block
-                auto aligned_area = ceil( current_garbage_block + sizeof( size_type ) + sizeof( pointer_type ), alignment );
-                auto tile = ceil( aligned_area + bytes, granularity_ );
+        /** Provides size of virtual range reserved for per-thread heaps
 
-                // if current garbage block cannot fit requested region
-                if ( auto remainder = current_garbage_block_tile - tile; remainder < 0 )
-                {
-                    // if maximum search depth reached
-                    if ( garbage_search_depth++ >= Policy::garbage_search_depth )
-                    {
-                        // unlock current garbage block and admit failture
-                        current_garbage_block_ref.get().store( current_garbage_block, std::memory_order_release );
-                        return nullptr;
-                    }
+        @retval Policy::heap_arena_size rounded up to heap block size
+        @throw never
+        */
+        static size_type heap_arena_size() noexcept
+        {
+            static const size_type value = heap_class_count_ > 0 ? ceil( virtual_block_size( Policy::heap_arena_size ), heap_block_size_ ) : 0;
+            return value;
+        }
 
-                    // wait till the next garbage block gets unlocked
-                    auto next_garbage_block = wait_till_hazarded( [&]() noexcept {
-                        return next_garbage_block_ref.get().load( std::memory_order_acquire ); }
-                    );
 
-                    // get lock over the next garbage block (no reason to sync the value, we'll do it immediately after)
-                    next_garbage_block_ref.get().store( next_garbage_block | hazard_, std::memory_order_relaxed );
+        /** Carves a part of given arena, reserves the arena on first use
 
-                    // unlock current garbage block 
-                    current_garbage_block_ref.get().store( current_garbage_block, std::memory_order_release );
+        The arena is reserved speculatively: if another thread has reserved it meanwhile, the range is released and
+        the one reserved by another thread is used instead. The range is aligned with the part size, so the part
+        header is found by masking a pointer inside the part
 
-                    // proceed to the next block
-                    current_garbage_block_ref = next_garbage_block_ref;
-                    current_garbage_block = next_garbage_block;
-                    continue;
-                }
-                else
+        @param [in] a - the arena
+        @param [in] size - size of the arena
+        @param [in] part - size of the part, a power of two
+        @retval beginning of the part or 0 if the arena cannot be reserved or is exhausted
+        @throw never
+        */
+        pointer_type carve_arena( arena& a, size_type size, size_type part ) noexcept
+        {
+            auto begin = a.begin_.load( std::memory_order_acquire );
+            if ( !begin )
+            {
+                try
                 {
-                    // there is a reminder
-                    if ( remainder > 0 )
+                    auto reserved = reinterpret_cast< pointer_type >( part > system_page_size() ? virtual_alloc_aligned( size, part, 0 ) : virtual_alloc( size ) );
+                    if ( a.begin_.compare_exchange_strong( begin, reserved, std::memory_order_acq_rel, std::memory_order_acquire ) )
                     {
-                        // update size field of current garbage block
-                        reinterpret_cast< garbage_block_header* >( current_garbage_block )->size_ = tile - current_garbage_block;
-
-                        // wait till the next garbage block gets unlocked
-                        auto next_garbage_block = wait_till_hazarded( [ & ]() noexcept {
-                            return next_garbage_block_ref.get().load( std::memory_order_acquire ); }
-                        );
-
-                        // mark up new garbage block header at tile
-                        reinterpret_cast< garbage_block_header* >( tile )->size_ = remainder;
-                        reinterpret_cast< garbage_block_header* >( tile )->next_.store( next_garbage_block, std::memory_order_relaxed );
-
-                        // replace allocated block with the reminder in the garbage list
-                        current_garbage_block_ref.get().store( tile, std::memory_order_release );
+                        begin = reserved;
                     }
                     else
                     {
-                        // wait till pointer to next block gets unlocked and assign it to garbage_block_ref cutting current garbage block from the sequence
-                        auto next = wait_till_hazarded( [&]() noexcept {
-                            return next_garbage_block_ref.get().load( std::memory_order_acquire ); }
-                        );
-                        current_garbage_block_ref.get().store( next, std::memory_order_release );
+                        // another thread has already reserved the arena
+                        virtual_free( reinterpret_cast< void* >( reserved ), size );
                     }
                 }
+                catch ( ... )
+                {
+                    // no way to reserve the arena, small pieces just go to the pool
+                    return 0;
+                }
+            }
 
-                // fill <block head ptr> field
-                get_block_header_ptr_ref( aligned_area ) = current_garbage_block;
+            auto offset = a.unallocated_.fetch_add( part, std::memory_order_acq_rel );
+            return offset + part > size ? 0 : begin + offset;
+        }
 
-                // return aligned region as the result
-                return reinterpret_cast< void* >( aligned_area );
-            }
+
+        /** Checks if given piece belongs to given arena
+
+        @param [in] a - the arena
+        @param [in] size - size of the arena
+        @param [in] p - pointer to the piece
+        @retval true if the piece belongs to the arena
+        @throw never
+        */
+        static bool in_arena( const arena& a, size_type size, const void* p ) noexcept
+        {
+            auto begin = a.begin_.load( std::memory_order_acquire );
+            auto piece = reinterpret_cast< pointer_type >( p );
+            return begin && piece >= begin && piece < begin + size;
         }
 
 
-    protected:
+        /** Allocates a piece on slab
 
-        /** Implements virtual std::prm::memory_resource::do_allocate()
+        Takes a released piece of the size class if any, otherwise carves new run out of slab range
+
+        @param [in] bytes - size of requested piece
+        @param [in] alignment - alignment of requested piece
+        @retval pointer to the piece or nullptr if the piece does not fit slabs or slab range is exhausted
+        @throw never
         */
-        void* do_allocate( std::size_t bytes, std::size_t alignment ) override
+        void* allocate_on_slab( std::size_t bytes, std::size_t alignment ) noexcept
         {
-            if ( !bytes )
+            if ( static_cast< size_type >( alignment ) > static_cast< size_type >( cache_line_size ) ) return nullptr;
+
+            auto size = ceil( static_cast< size_type >( bytes ), std::max( slab_quantum_, static_cast< size_type >( alignment ) ) );
+            if ( size > static_cast< size_type >( Policy::slab_max_size ) ) return nullptr;
+            auto& cls = slabs_[ size / slab_quantum_ - 1 ];
+
+            // lock the class and pop released piece
+            if ( auto piece = wait_till_hazarded( [&]() noexcept {
+                return cls.head_.fetch_or( hazard_, std::memory_order_acq_rel ); }, this
+            ) )
             {
-                throw std::invalid_argument( "azul::lock_free_memory_resource::do_allocate(): invalid requested size" );
+                cls.head_.store( *reinterpret_cast< pointer_type* >( piece ), std::memory_order_release );
+                notify( event::slab_allocation );
+                return reinterpret_cast< void* >( piece );
             }
-
-            // check alignment
-            if ( !alignment ||
-                ( alignment & ( alignment - 1 ) ) != 0 ||
-                static_cast< size_type >( alignment ) > system_page_size() )
+            cls.head_.store( 0, std::memory_order_release );
+
+            // carve new run
+            auto run_size = slab_run_size();
+            auto run = carve_arena( slab_arena_, slab_arena_size(), run_size );
+            if ( !run ) return nullptr;
+            reinterpret_cast< slab_run_header* >( run )->size_ = size;
+
+            // take the first piece and chain the rest ones
+            auto first = run + static_cast< size_type >( sizeof( slab_run_header ) );
+            auto last = first + ( ( run + run_size - first ) / size - 1 ) * size;
+            if ( last > first )
             {
-                throw std::invalid_argument( "azul::lock_free_memory_resource::do_allocate(): invalid requested alignment" );
+                for ( auto piece = first + size; piece < last; piece += size )
+                {
+                    *reinterpret_cast< pointer_type* >( piece ) = piece + size;
+                }
+                put_to_slab( cls, first + size, last );
             }
 
-            // calculate size of pool block that could fit requested region
-            auto required_pool_block_size = ceil( ceil( ceil( sizeof( pool_block_header ), granularity_ ) + piece_internal_fields_size_, alignment ) + bytes, granularity_ );
-            if ( required_pool_block_size < 0 ) throw std::bad_alloc();
+            notify( event::slab_allocation );
+            return reinterpret_cast< void* >( first );
+        }
 
-            // if block too large to be allocated on pool
-            if ( required_pool_block_size > pool_block_size() )
-            {
-                // allocate block directly in the process's virtual space
-                return allocate_large_block( bytes, alignment );
-            }
 
-            // try allocate block on garbage
-            if ( auto block = allocate_on_garbage( bytes, alignment ) )
+        /** Checks if given piece is allocated on slab
+
+        @param [in] p - pointer to the piece
+        @retval true if the piece belongs to slab range
+        @throw never
+        */
+        bool is_slab_piece( const void* p ) const noexcept
+        {
+            return in_arena( slab_arena_, slab_arena_size(), p );
+        }
+
+
+        /** Prepends a chain of free slots to free slots of large block registry
+
+        @param [in] first - the first slot of the chain
+        @param [in] last - the last slot of the chain
+        @throw never
+        */
+        void put_to_free_slots( typename large_block_registry_chunk::slot* first, typename large_block_registry_chunk::slot* last ) noexcept
+        {
+            while ( true )
             {
-                return block;
+                // wait till the head gets unlocked, CAS fails if somebody locks it meanwhile
+                auto head = wait_till_hazarded( [&]() noexcept {
+                    return large_block_free_slots_.load( std::memory_order_acquire ); }, this
+                );
+                last->next_free_ = head;
+                if ( large_block_free_slots_.compare_exchange_weak( head, reinterpret_cast< pointer_type >( first ), std::memory_order_acq_rel, std::memory_order_relaxed ) ) break;
             }
-            else
+        }
+
+
+        /** Puts allocated large block to the registry
+
+        @param [in] block - large block
+        @param [in] size - size of the block
+        @throw std::bad_alloc if there is no free slot and memory is low
+        */
+        void register_large_block( pointer_type block, size_type size )
+        {
+            using slot_type = typename large_block_registry_chunk::slot;
+
+            // lock free slots and take the first one
+            auto slot = reinterpret_cast< slot_type* >( wait_till_hazarded( [&]() noexcept {
+                return large_block_free_slots_.fetch_or( hazard_, std::memory_order_acq_rel ); }, this
+            ) );
+            large_block_free_slots_.store( slot ? slot->next_free_ : 0, std::memory_order_release );
+
+            // or add new chunk and give the rest of its slots to free ones
+            if ( !slot )
             {
-                // allocate block on pool
-                return allocate_on_pool( bytes, alignment );
+                auto chunk = new large_block_registry_chunk;
+                for ( size_type i = 1; i + 1 < large_block_registry_chunk_size_; ++i ) chunk->slots_[ i ].next_free_ = reinterpret_cast< pointer_type >( &chunk->slots_[ i + 1 ] );
+                put_to_free_slots( &chunk->slots_[ 1 ], &chunk->slots_[ large_block_registry_chunk_size_ - 1 ] );
+                chunk->next_ = large_blocks_.load( std::memory_order_relaxed );
+                while ( !large_blocks_.compare_exchange_weak( chunk->next_, chunk, std::memory_order_acq_rel, std::memory_order_relaxed ) );
+                slot = &chunk->slots_[ 0 ];
             }
+
+            slot->size_ = size;
+            slot->block_.store( block, std::memory_order_release );
+            get_large_block_slot_ref( block ) = slot;
         }
 
 
-        /** Implements virtual std::prm::memory_resource::do_deallocate()
+        /** Removes released large block from the registry
 
-        @param [in] p - pointer to region to be deallocated
+        @param [in] block - large block
         @throw never
         */
-        void do_deallocate( void* p, std::size_t, std::size_t ) override
+        void unregister_large_block( pointer_type block ) noexcept
         {
-            if ( p )
+            auto slot = get_large_block_slot_ref( block );
+            slot->block_.store( 0, std::memory_order_release );
+            put_to_free_slots( slot, slot );
+        }
+
+
+        /** Updates moved or resized large block in the registry
+
+        @param [in] moved - new address of the block, the header moves together with the block
+        @param [in] size - new size of the block
+        @throw never
+        */
+        void update_large_block( pointer_type moved, size_type size ) noexcept
+        {
+            auto slot = get_large_block_slot_ref( moved );
+            slot->size_ = size;
+            slot->block_.store( moved, std::memory_order_release );
+        }
+
+
+        /** Releases all the large blocks kept by the registry
+
+        @throw never
+        */
+        void release_large_blocks() noexcept
+        {
+            for ( auto chunk = large_blocks_.load( std::memory_order_acquire ); chunk; chunk = chunk->next_ )
             {
-                auto block_head_ptr = get_block_header_ptr_ref( reinterpret_cast< pointer_type >( p ) );
-                auto block_size = *reinterpret_cast< size_type* >( block_head_ptr );
-                if ( block_size > pool_block_capacity() )
-                {
-                    virtual_free( reinterpret_cast< void* >( block_head_ptr ), block_size );
-                }
-                else
+                for ( auto& slot : chunk->slots_ )
                 {
-                    while ( true )
+                    if ( auto block = slot.block_.exchange( 0, std::memory_order_acq_rel ) )
                     {
-                        // prepend block to garbage ( no reason to touch <block size> field )
-                        auto garbage = garbage_.load( std::memory_order_acquire );
-                        reinterpret_cast< garbage_block_header* >( block_head_ptr )->next_.store( garbage, std::memory_order_relaxed );
-                        if ( garbage_.compare_exchange_weak( garbage, block_head_ptr, std::memory_order_acq_rel, std::memory_order_relaxed ) ) break;
+                        // the slot is reused as soon as it is freed, so it is freed the last
+                        auto size = slot.size_;
+                        virtual_free( reinterpret_cast< void* >( block ), size );
+                        notify( event::large_block_unmap );
+                        large_bytes_.fetch_sub( size, std::memory_order_relaxed );
+                        large_count_.fetch_sub( 1, std::memory_order_relaxed );
+                        put_to_free_slots( &slot, &slot );
                     }
                 }
             }
         }
 
 
-        /** Implements virtual std::prm::memory_resource::do_is_equal()
+        /** Provides time stamp for cached large blocks
 
-        @param [in] other - memory resource to be evaluated
-        @retval true if the same instance
+        @retval current time if Policy::large_cache_decay is set, otherwise 1
+        @throw never
         */
-        bool do_is_equal( const std::pmr::memory_resource& other ) const noexcept override
+        static std::int64_t large_cache_stamp() noexcept
         {
-            return ( this == &other );
+            if constexpr ( Policy::large_cache_decay > 0 )
+            {
+                return static_cast< std::int64_t >( std::chrono::steady_clock::now().time_since_epoch().count() );
+            }
+            else
+            {
+                return 1;
+            }
         }
 
-    public:
-
-        /** Default constructor
 
-        Allocates first pool block
+        /** Provides index of large block cache bucket for a block of given size
 
-        @param [in] initial_buffer_size - desired size of initial pool block
-        @throw std::bad_alloc if memory is low
+        @param [in] size - size of the block
+        @retval index of the bucket
+        @throw never
         */
-        lock_free_memory_resource( std::size_t initial_buffer_size = 0 )
+        static size_type large_cache_bucket( size_type size ) noexcept
         {
-            grow_pool( initial_buffer_size );
+            size_type bucket = 0;
+            for ( auto pages = size / system_page_size(); pages > 1 && bucket + 1 < large_cache_bucket_count_; pages >>= 1, ++bucket );
+            return bucket;
         }
 
 
-        /** Destructor
-
-        Releases allocated birtual memory
+        /** Prepends released large block to its cache bucket, the block must be already counted in large_cache_bytes_
 
+        @param [in] block - the block
+        @param [in] size - size of the block
+        @param [in] stamp - release time
         @throw never
         */
-        ~lock_free_memory_resource()
+        void put_to_large_cache( pointer_type block, size_type size, std::int64_t stamp ) noexcept
         {
-            auto pool = pool_.load( std::memory_order_acquire );
-            while ( pool )
+            auto& header = *reinterpret_cast< garbage_block_header* >( block );
+            header.size_ = size;
+            header.stamp_ = stamp;
+
+            auto& head = large_cache_[ large_cache_bucket( size ) ].head_;
+            while ( true )
             {
-                auto& header = *reinterpret_cast< pool_block_header* >( pool );
-                auto next = header.next_;
-                auto size = header.size_;
-                virtual_free( reinterpret_cast< void* >( pool ), size );
-                pool = next;
+                // wait till bucket head gets unlocked, CAS fails if somebody locks it meanwhile
+                auto first = wait_till_hazarded( [&]() noexcept {
+                    return head.load( std::memory_order_acquire ); }, this
+                );
+                header.next_.store( first, std::memory_order_relaxed );
+                if ( head.compare_exchange_weak( first, block, std::memory_order_acq_rel, std::memory_order_relaxed ) ) break;
+                notify( event::garbage_cas_retry );
             }
         }
-    };
-}
+
+
+        /** Checks if cached large block could serve a request of given size
+
+        Windows does not allow releasing a part of allocated region, so blocks of exact size fit there only. Block of
+        a multiple of huge page size could be mapped by huge pages, which cannot be split at other offsets, so it fits
+        requests of a multiple of huge page size only
+
+        @param [in] cached - size of cached block
+        @param [in] size - required size
+        @retval true if the block fits
+        @throw never
+        */
+        static bool fits_large_cache( size_type cached, size_type size ) noexcept
+        {
+#ifdef _WIN32
+            return cached == size;
+#else
+            if constexpr ( Policy::huge_pages )
+            {
+                auto huge = huge_page_size();
+                if ( huge > system_page_size() && cached > size && cached % huge == 0 && size % huge != 0 ) return false;
+            }
+            return cached >= size;
+#endif
+        }
+
+
+        /** Takes cached large block of at least given size, splits off and caches the remainder
+
+        @param [in] size - required size
+        @retval the block or 0 if cache has no fitting block
+        @throw never
+        */
+        pointer_type take_from_large_cache( size_type size ) noexcept
+        {
+            for ( auto bucket = large_cache_bucket( size ); bucket < large_cache_bucket_count_; ++bucket )
+            {
+                auto& head = large_cache_[ bucket ].head_;
+                if ( !head.load( std::memory_order_relaxed ) ) continue;
+
+                // lock the bucket and check its top block, any block of upper buckets fits
+                auto block = wait_till_hazarded( [&]() noexcept {
+                    return head.fetch_or( hazard_, std::memory_order_acq_rel ); }, this
+                );
+                auto header = reinterpret_cast< garbage_block_header* >( block );
+                if ( !block || !fits_large_cache( header->size_, size ) )
+                {
+                    head.store( block, std::memory_order_release );
+                    continue;
+                }
+                head.store( header->next_.load( std::memory_order_acquire ), std::memory_order_release );
+
+                large_cache_bytes_.fetch_sub( size, std::memory_order_relaxed );
+                if ( header->size_ > size ) put_to_large_cache( block + size, header->size_ - size, header->stamp_ );
+                return block;
+            }
+            return 0;
+        }
+
+
+        /** Puts released large block to cache if there is a room for it
+
+        @param [in] block - the block
+        @param [in] size - size of the block
+        @retval true if the block has been cached
+        @throw never
+        */
+        bool cache_large_block( pointer_type block, size_type size ) noexcept
+        {
+            if ( size > static_cast< size_type >( Policy::large_cache_size ) ) return false;
+            if ( large_cache_bytes_.fetch_add( size, std::memory_order_relaxed ) + size > static_cast< size_type >( Policy::large_cache_size ) )
+            {
+                large_cache_bytes_.fetch_sub( size, std::memory_order_relaxed );
+                return false;
+            }
+
+            auto stamp = large_cache_stamp();
+            put_to_large_cache( block, size, stamp );
+
+            if constexpr ( Policy::large_cache_decay > 0 )
+            {
+                using decay_type = std::chrono::duration< std::int64_t, std::chrono::steady_clock::period >;
+                constexpr auto decay = std::chrono::duration_cast< decay_type >( std::chrono::milliseconds( Policy::large_cache_decay ) ).count();
+
+                // only one thread does the job
+                auto next_trim = next_large_cache_trim_.load( std::memory_order_relaxed );
+                if ( stamp >= next_trim && next_large_cache_trim_.compare_exchange_strong( next_trim, stamp + decay, std::memory_order_relaxed ) )
+                {
+                    trim_large_cache( stamp - decay );
+                }
+            }
+            return true;
+        }
+
+
+        /** Unmaps cached large blocks released before given moment
+
+        @param [in] released_before - time stamp
+        @retval number of bytes returned to OS
+        @throw never
+        */
+        size_type trim_large_cache( std::int64_t released_before ) noexcept
+        {
+            size_type purged = 0;
+            for ( size_type bucket = 0; bucket < large_cache_bucket_count_; ++bucket )
+            {
+                auto& head = large_cache_[ bucket ].head_;
+                if ( !head.load( std::memory_order_relaxed ) ) continue;
+
+                // detach whole bucket
+                auto block = wait_till_hazarded( [&]() noexcept {
+                    return head.fetch_or( hazard_, std::memory_order_acq_rel ); }, this
+                );
+                head.store( 0, std::memory_order_release );
+
+                while ( block )
+                {
+                    auto& header = *reinterpret_cast< garbage_block_header* >( block );
+                    auto next = header.next_.load( std::memory_order_acquire );
+                    if ( header.stamp_ < released_before )
+                    {
+                        auto size = header.size_;
+                        large_cache_bytes_.fetch_sub( size, std::memory_order_relaxed );
+                        virtual_free( reinterpret_cast< void* >( block ), size );
+                        notify( event::large_block_unmap );
+                        purged += size;
+                    }
+                    else
+                    {
+                        put_to_large_cache( block, header.size_, header.stamp_ );
+                    }
+                    block = next;
+                }
+            }
+            return purged;
+        }
+
+
+        /** Allocates large memory block directly in process's virtual space not in the lock_free_memory_resource
+
+        @param [in] bytes - requested block size
+        @param [in] alignment - requested block alignment
+        @param [out] fresh - optional, receives true if the block has been just mapped, so it is zero-filled
+        @retval pointer to aligned memory region
+        @throw std::bad_alloc on failture
+        */
+        void* allocate_large_block( std::size_t bytes, std::size_t alignment, bool* fresh = nullptr )
+        {
+            // calculate required size
+            size_type sz = large_block_size( bytes, alignment );
+
+            // take cached block or allocate memory, cached blocks are aligned with page size only
+            pointer_type block = 0;
+            auto over_aligned = static_cast< size_type >( alignment ) > system_page_size();
+            if constexpr ( large_cache_bucket_count_ > 0 )
+            {
+                if ( !over_aligned ) block = take_from_large_cache( sz );
+            }
+            auto cached = block != 0;
+            if ( !cached )
+            {
+                block = reinterpret_cast< pointer_type >( over_aligned
+                    ? virtual_alloc_aligned( sz, static_cast< size_type >( alignment ), large_piece_offset( alignment ) )
+                    : virtual_alloc( sz ) );
+            }
+
+            try
+            {
+                register_large_block( block, sz );
+            }
+            catch ( ... )
+            {
+                virtual_free( reinterpret_cast< void* >( block ), sz );
+                throw;
+            }
+            notify( cached ? event::large_cache_hit : event::large_block_map );
+            if ( fresh ) *fresh = !cached;
+            large_bytes_.fetch_add( sz, std::memory_order_relaxed );
+            large_count_.fetch_add( 1, std::memory_order_relaxed );
+
+            // find aligned region 
+            auto aligned_area = block + large_piece_offset( alignment );
+
+            if constexpr ( !Policy::trusted_size )
+            {
+                // fill out block size
+                *reinterpret_cast< size_type* >( block ) = sz;
+
+                // fill out block pointer
+                get_block_header_ptr_ref( aligned_area ) = block;
+            }
+            set_piece_trailer( block + sz );
+
+            // return pointer to aligned region as the result
+            return reinterpret_cast< void* >( aligned_area );
+        }
+
+
+        /** Marks up header of new pool block
+
+        @param [in] allocated - allocated virtual memory block
+        @param [in] size - size of the block
+        @param [in] next - next pool block
+        @retval pool block
+        @throw never
+        */
+        static pointer_type make_pool_block( void* allocated, size_type size, pointer_type next ) noexcept
+        {
+            auto& header = *reinterpret_cast< pool_block_header* >( allocated );
+            header.next_ = next;
+            header.unallocated_.store( ceil( reinterpret_cast< pointer_type >( allocated ) + sizeof( pool_block_header ), granularity_ ), std::memory_order_relaxed );
+            header.dirty_.store( header.unallocated_.load( std::memory_order_relaxed ), std::memory_order_relaxed );
+            header.fresh_.store( header.unallocated_.load( std::memory_order_relaxed ), std::memory_order_relaxed );
+            header.size_.store( size, std::memory_order_relaxed );
+            return reinterpret_cast< pointer_type >( allocated );
+        }
+
+
+        /** Marks area of pool block up to given position as allocated once, so it is not zero-filled anymore
+
+        MUST be called before unallocated_ of the pool block gets moved back below the position
+
+        @param [in] header - pool block header
+        @param [in] position - end of area being given back
+        @throw never
+        */
+        static void mark_used( pool_block_header& header, pointer_type position ) noexcept
+        {
+            auto fresh = header.fresh_.load( std::memory_order_acquire );
+            while ( fresh < position && !header.fresh_.compare_exchange_weak( fresh, position, std::memory_order_acq_rel, std::memory_order_acquire ) );
+        }
+
+
+        /** Allocates and prepends another pool block
+
+        The block is allocated speculatively: if another thread has grown the pool meanwhile, the block is released and
+        the pool grown by another thread is used instead, so neither thread waits for another one
+
+        @param [in] desired_size - desired size of pool block
+        @throw std::bad_alloc on failture
+        */
+        void grow_pool( std::size_t desired_size = 0 )
+        {
+            auto pool = pool_.load( std::memory_order_acquire );
+
+            // determine desired placement of new block right after the top pool block
+            void* desired = pool ? reinterpret_cast< void* >( pool + reinterpret_cast< pool_block_header* >( pool )->size_.load( std::memory_order_acquire ) ) : nullptr;
+
+            // allocate new pool block
+            auto size = pool_block_size( desired_size );
+            auto allocated = virtual_alloc( size );
+            notify( event::pool_grow );
+            if ( allocated == desired )
+            {
+                // if new block allocated right after the top pool block just extend the top pool block
+                reinterpret_cast< pool_block_header* >( pool )->size_.fetch_add( size, std::memory_order_acq_rel );
+                return;
+            }
+
+            // mark up new pool block header
+            auto block = make_pool_block( allocated, size, pool );
+
+            // and try to put new block on top of the pool
+            if ( !pool_.compare_exchange_strong( pool, block, std::memory_order_acq_rel, std::memory_order_acquire ) )
+            {
+                // another thread has already grown the pool
+                virtual_free( allocated, size );
+            }
+        }
+
+
+        /** Size of the reserve that wakes background replenisher up */
+        static constexpr size_type reserve_threshold_ = std::max< size_type >( Policy::reserve_low_watermark, 1 );
+
+
+        /** Background replenisher loop
+
+        As soon as the reserve drops below low watermark fills it up to Policy::reserve_size with pre-faulted pool blocks
+
+        @throw never
+        */
+        void replenish() noexcept
+        {
+            static_assert( Policy::reserve_low_watermark <= Policy::reserve_size, "Policy::reserve_low_watermark supposed not to exceed Policy::reserve_size" );
+
+            auto size = pool_block_size();
+            while ( !replenisher_stop_.load( std::memory_order_acquire ) )
+            {
+                auto failed = false;
+                try
+                {
+                    auto below_watermark = reserve_bytes_.load( std::memory_order_acquire ) < reserve_threshold_;
+                    while ( below_watermark && reserve_bytes_.load( std::memory_order_acquire ) < static_cast< size_type >( Policy::reserve_size ) )
+                    {
+                        if ( replenisher_stop_.load( std::memory_order_acquire ) ) return;
+
+                        auto block = make_pool_block( virtual_alloc( size ), size, 0 );
+
+                        // touch every page to get it backed by physical memory
+                        for ( auto page = block + system_page_size(); page < block + size; page += system_page_size() )
+                        {
+                            *reinterpret_cast< volatile char* >( page ) = 0;
+                        }
+
+                        // push the block to the reserve
+                        auto& header = *reinterpret_cast< pool_block_header* >( block );
+                        while ( true )
+                        {
+                            header.next_ = wait_till_hazarded( [&]() noexcept {
+                                return reserve_.load( std::memory_order_acquire ); }, this
+                            );
+                            auto reserve = header.next_;
+                            if ( reserve_.compare_exchange_weak( reserve, block, std::memory_order_acq_rel, std::memory_order_relaxed ) ) break;
+                        }
+                        reserve_bytes_.fetch_add( size, std::memory_order_acq_rel );
+                    }
+                }
+                catch ( ... )
+                {
+                    failed = true;
+                }
+
+                std::unique_lock< std::mutex > lock( replenisher_mutex_ );
+                if ( failed )
+                {
+                    // memory is low, try again later
+                    replenisher_cv_.wait_for( lock, std::chrono::milliseconds( 10 ), [ this ]() noexcept {
+                        return replenisher_stop_.load( std::memory_order_acquire ); }
+                    );
+                }
+                else
+                {
+                    // wait till the reserve drops below low watermark, notifiers pass through the mutex, so no wakeup is lost
+                    replenisher_cv_.wait( lock, [ this ]() noexcept {
+                        return replenisher_stop_.load( std::memory_order_acquire ) || reserve_bytes_.load( std::memory_order_acquire ) < reserve_threshold_; }
+                    );
+                }
+            }
+        }
+
+
+        /** Moves a block from the reserve to the top of the pool
+
+        @retval true if reserved block has been put to the pool, false if the reserve is empty
+        @throw never
+        */
+        bool grow_pool_from_reserve() noexcept
+        {
+            // lock the reserve
+            auto block = wait_till_hazarded( [&]() noexcept {
+                return reserve_.fetch_or( hazard_, std::memory_order_acq_rel ); }, this
+            );
+
+            if ( !block )
+            {
+                reserve_.store( 0, std::memory_order_release );
+                return false;
+            }
+
+            // detach the top block and unlock the reserve
+            auto& header = *reinterpret_cast< pool_block_header* >( block );
+            reserve_.store( header.next_, std::memory_order_release );
+            auto size = header.size_.load( std::memory_order_relaxed );
+            if ( reserve_bytes_.fetch_sub( size, std::memory_order_acq_rel ) - size < reserve_threshold_ )
+            {
+                // the replenisher checks the reserve and starts waiting under the mutex, so passing through it
+                // guarantees the replenisher either sees the drop or is already waiting for the notification
+                {
+                    std::lock_guard< std::mutex > lock( replenisher_mutex_ );
+                }
+                replenisher_cv_.notify_one();
+            }
+
+            // prepend the block to the pool
+            notify( event::reserve_take );
+            auto pool = pool_.load( std::memory_order_acquire );
+            do
+            {
+                header.next_ = pool;
+            }
+            while ( !pool_.compare_exchange_weak( pool, block, std::memory_order_acq_rel, std::memory_order_acquire ) );
+
+            return true;
+        }
+
+
+        /** Allocates a region of specified size and alignment on the pool
+        
+        If there is not a pool block grows with unallocated area large enough - grows the pool with new block
+
+        @param [in] bytes - size of requested region in bytes
+        @param [in] alignment - alignment of requested region
+        @param [out] fresh - optional, receives true if the region has never been allocated, so it is zero-filled
+        @retval pointer to aligned region of specified size
+        @throws std::bad_alloc on failture
+        */
+        void* allocate_on_pool( std::size_t bytes, std::size_t alignment, bool* fresh = nullptr )
+        {
+            // get current pool pointer
+            auto current_pool = pool_.load( std::memory_order_acquire );
+
+            // released blocks are merged once per call, so concurrent deallocations cannot keep the thread from growing the pool
+            [[maybe_unused]] auto coalesced = false;
+
+            while ( true )
+            {
+                // search through pool blocks
+                auto current_pool_block = current_pool;
+                while ( current_pool_block )
+                {
+                    // get pool block header
+                    assert( current_pool_block % std::alignment_of_v< pool_block_header > == 0 );
+                    auto& header = *reinterpret_cast< pool_block_header* >( current_pool_block );
+
+                    while ( true )
+                    {
+                        // get current pointer to unallocated area inside current block pool
+                        auto unallocated = header.unallocated_.load( std::memory_order_acquire );
+                        assert( unallocated % granularity_ == 0 );
+
+                        // get aligned pointer with respect to block's fields
+                        auto aligned_area = ceil( unallocated + piece_internal_fields_size_, alignment );
+
+                        // calculate end of the block
+                        auto tile = ceil( aligned_area + bytes + piece_trailer_size_, granularity_ );
+
+                        // if pool block has NOT enough unallocated space
+                        if ( tile > current_pool_block + header.size_.load( std::memory_order_acquire ) ) break;
+
+                        // try allocate required memory block from current pool block
+                        if ( header.unallocated_.compare_exchange_weak( unallocated, tile, std::memory_order_acq_rel, std::memory_order_relaxed ) )
+                        {
+                            if constexpr ( Policy::trusted_size )
+                            {
+                                // gotcha! -> the piece has no header, so alignment gap is not a part of it
+                                if ( aligned_area > unallocated ) put_gap_to_garbage( unallocated, aligned_area - unallocated );
+                            }
+                            else
+                            {
+                                // gotcha! -> fill block size field
+                                *reinterpret_cast< size_type* >( unallocated ) = static_cast< size_type >( tile - unallocated );
+
+                                // fill block head pointer
+                                get_block_header_ptr_ref( aligned_area ) = unallocated;
+                            }
+                            set_piece_trailer( tile );
+                            notify( event::pool_allocation );
+                            if ( fresh ) *fresh = aligned_area >= header.fresh_.load( std::memory_order_acquire );
+
+                            // return pointer to aligned region as the result
+                            return reinterpret_cast< void* >( aligned_area );
+                        }
+
+                        // another thread outrun this one -> try again on current pool block
+                        notify( event::pool_cas_retry );
+                    }
+
+                    // current block does not have enough space -> proceed to the next one
+                    current_pool_block = reinterpret_cast< pool_block_header* >( current_pool_block )->next_;
+                }
+
+                // get pool pointer
+                auto new_pool = pool_.load( std::memory_order_acquire );
+
+                // if just received value is not equal to current pool pointer -> somebody else has already grown the pool
+                if ( new_pool != current_pool )
+                {
+                    // repeat with new pool pointer
+                    current_pool = new_pool;
+                    continue;
+                }
+
+                // merge released blocks, it could be enough to avoid growing
+                if constexpr ( Policy::coalescing )
+                {
+                    if ( !coalesced )
+                    {
+                        coalesced = true;
+                        if ( coalesce() )
+                        {
+                            if ( auto block = allocate_on_garbage( bytes, alignment ) )
+                            {
+                                notify( event::garbage_allocation );
+                                return block;
+                            }
+                            continue;
+                        }
+                    }
+                }
+
+                // if there is not pool block capable to fit requested block - grow the pool
+                if constexpr ( Policy::reserve_size > 0 )
+                {
+                    if ( grow_pool_from_reserve() ) continue;
+                }
+                grow_pool();
+            }
+        }
+
+
+        /** Provides index of the first garbage bin at or after given one which is probably not empty
+
+        @param [in] bin - index of garbage bin to start from
+        @retval index of non-empty bin or garbage_bin_count_ if all the bins are empty
+        @throw never
+        */
+        size_type next_garbage_bin( size_type bin ) const noexcept
+        {
+            for ( auto word = bin / 64; word < garbage_bitmap_size_; ++word )
+            {
+                auto bits = garbage_bitmap_[ word ].load( std::memory_order_acquire );
+                if ( word == bin / 64 ) bits &= ~std::uint64_t( 0 ) << ( bin % 64 );
+                if ( bits )
+                {
+                    size_type index = word * 64;
+                    for ( ; ( bits & 1 ) == 0; bits >>= 1, ++index );
+                    return std::min( index, garbage_bin_count_ );
+                }
+            }
+            return garbage_bin_count_;
+        }
+
+
+        /** Tries to allocate a region of requested size and alignment from given garbage bin
+
+        @param [in] bin - index of garbage bin
+        @param [in] bytes - size of requested region in bytes
+        @param [in] alignment - alignment of requested region
+        @retval pointer to aligned region or nullptr if the bin does not have fitting block
+        @throw never
+        */
+        void* allocate_on_garbage_bin( size_type bin, std::size_t bytes, std::size_t alignment ) noexcept
+        {
+            static_assert( Policy::garbage_search_depth, "Policy::garbage_search_depth supposed to be positive integer" );
+
+            std::size_t garbage_search_depth = 0;
+
+            // use head of the bin as current garbage block an lock it
+            auto current_garbage_block_ref = std::ref( garbage_[ bin ].head_ );
+            auto current_garbage_block = wait_till_hazarded( [&]() {
+                return current_garbage_block_ref.get().fetch_or( hazard_, std::memory_order_acq_rel ); }, this
+            );
+
+            // the bin is empty, clear its bit while holding the lock, so nobody could put a block meanwhile
+            if ( !current_garbage_block )
+            {
+                garbage_bitmap_[ bin / 64 ].fetch_and( ~( std::uint64_t( 1 ) << ( bin % 64 ) ), std::memory_order_acq_rel );
+            }
+
+            while ( true )
+            {
+                // nothing left to search through
+                if ( !current_garbage_block )
+                {
+                    // unlock current garbage block and leave
+                    current_garbage_block_ref.get().store( current_garbage_block, std::memory_order_release );
+                    return nullptr;
+                }
+
+                // get reference to the next garbage block pointer
+                auto next_garbage_block_ref = std::ref( reinterpret_cast< garbage_block_header* >( current_garbage_block )->next_ );
+
+                // get current garbage block tile
+                auto current_garbage_block_tile = current_garbage_block + reinterpret_cast< garbage_block_header* >( current_garbage_block )->size_;
+
+                // calculate aligned region placement and tile of requested block
+                auto aligned_area = ceil( current_garbage_block + piece_internal_fields_size_, alignment );
+                auto tile = ceil( aligned_area + bytes + piece_trailer_size_, granularity_ );
+
+                // if current garbage block cannot fit requested region
+                if ( auto remainder = current_garbage_block_tile - tile; remainder < 0 )
+                {
+                    // if maximum search depth reached
+                    if ( garbage_search_depth++ >= Policy::garbage_search_depth )
+                    {
+                        // unlock current garbage block and admit failture
+                        current_garbage_block_ref.get().store( current_garbage_block, std::memory_order_release );
+                        return nullptr;
+                    }
+
+                    // wait till the next garbage block gets unlocked
+                    auto next_garbage_block = wait_till_hazarded( [&]() noexcept {
+                        return next_garbage_block_ref.get().load( std::memory_order_acquire ); }, this
+                    );
+
+                    // get lock over the next garbage block (no reason to sync the value, we'll do it immediately after)
+                    next_garbage_block_ref.get().store( next_garbage_block | hazard_, std::memory_order_relaxed );
+
+                    // unlock current garbage block 
+                    current_garbage_block_ref.get().store( current_garbage_block, std::memory_order_release );
+
+                    // proceed to the next block
+                    notify( event::garbage_search_step );
+                    current_garbage_block_ref = next_garbage_block_ref;
+                    current_garbage_block = next_garbage_block;
+                    continue;
+                }
+                else
+                {
+                    // wait till the next garbage block gets unlocked
+                    auto next_garbage_block = wait_till_hazarded( [&]() noexcept {
+                        return next_garbage_block_ref.get().load( std::memory_order_acquire ); }, this
+                    );
+
+                    // there is a reminder
+                    if ( remainder > 0 )
+                    {
+                        // update size field of current garbage block
+                        reinterpret_cast< garbage_block_header* >( current_garbage_block )->size_ = tile - current_garbage_block;
+
+                        // mark up new garbage block header at tile
+                        reinterpret_cast< garbage_block_header* >( tile )->size_ = remainder;
+                        reinterpret_cast< garbage_block_header* >( tile )->stamp_ = reinterpret_cast< garbage_block_header* >( current_garbage_block )->stamp_;
+
+                        if ( auto remainder_bin = garbage_bin_index( remainder ); remainder_bin == bin )
+                        {
+                            // replace allocated block with the reminder in the garbage list
+                            reinterpret_cast< garbage_block_header* >( tile )->next_.store( next_garbage_block, std::memory_order_relaxed );
+                            current_garbage_block_ref.get().store( tile, std::memory_order_release );
+                        }
+                        else
+                        {
+                            // cut allocated block from the sequence and move the remainder to its own bin
+                            current_garbage_block_ref.get().store( next_garbage_block, std::memory_order_release );
+                            put_to_garbage( remainder_bin, tile, tile );
+                        }
+                    }
+                    else
+                    {
+                        // cut current garbage block from the sequence
+                        current_garbage_block_ref.get().store( next_garbage_block, std::memory_order_release );
+                    }
+                }
+
+                if constexpr ( Policy::trusted_size )
+                {
+                    // the piece has no header, so alignment gap is not a part of it
+                    if ( aligned_area > current_garbage_block ) put_gap_to_garbage( current_garbage_block, aligned_area - current_garbage_block );
+                }
+                else
+                {
+                    // fill <block head ptr> field
+                    get_block_header_ptr_ref( aligned_area ) = current_garbage_block;
+                }
+                set_piece_trailer( tile );
+
+                // return aligned region as the result
+                return reinterpret_cast< void* >( aligned_area );
+            }
+        }
+
+
+        /** Tries to allocate a region of requested size and alignment from garbage
+
+        Searches through the bin of required size first, any block of upper bins fits the request
+
+        @param [in] bytes - size of requested region in bytes
+        @param [in] alignment - alignment of requested region
+        @retval pointer to aligned region or nullptr if garbage does not have fitting block
+        @throw never
+        */
+        void* allocate_on_garbage( std::size_t bytes, std::size_t alignment ) noexcept
+        {
+            // garbage blocks are aligned with granularity, so the block size is enough in the worst case
+            auto required = ceil( ceil( piece_internal_fields_size_, alignment ) + bytes + piece_trailer_size_, granularity_ );
+            auto bin = garbage_bin_index( std::min( required, ceil( Policy::block_size, granularity_ ) ) );
+
+            for ( bin = next_garbage_bin( bin ); bin < garbage_bin_count_; bin = next_garbage_bin( bin + 1 ) )
+            {
+                if ( auto block = allocate_on_garbage_bin( bin, bytes, alignment ) ) return block;
+            }
+
+            return nullptr;
+        }
+
+
+        /** Prepends a chain of released blocks to garbage bin
+
+        @param [in] bin - index of garbage bin
+        @param [in] first - the first block of the chain
+        @param [in] last - the last block of the chain
+        @throw never
+        */
+        void put_to_garbage( size_type bin, pointer_type first, pointer_type last ) noexcept
+        {
+            assert( first && last && bin < garbage_bin_count_ );
+            auto& head = garbage_[ bin ].head_;
+            while ( true )
+            {
+                // wait till bin head gets unlocked, CAS fails if somebody locks it meanwhile
+                auto garbage = wait_till_hazarded( [&]() noexcept {
+                    return head.load( std::memory_order_acquire ); }, this
+                );
+                reinterpret_cast< garbage_block_header* >( last )->next_.store( garbage, std::memory_order_relaxed );
+                if ( head.compare_exchange_weak( garbage, first, std::memory_order_acq_rel, std::memory_order_relaxed ) ) break;
+                notify( event::garbage_cas_retry );
+            }
+
+            // mark the bin as non-empty
+            auto& word = garbage_bitmap_[ bin / 64 ];
+            auto bit = std::uint64_t( 1 ) << ( bin % 64 );
+            if ( ( word.load( std::memory_order_acquire ) & bit ) == 0 ) word.fetch_or( bit, std::memory_order_acq_rel );
+        }
+
+
+        /** Prepends a released block to garbage
+
+        @param [in] block - released block
+        @throw never
+        */
+        void put_to_garbage( pointer_type block ) noexcept
+        {
+            auto block_size = reinterpret_cast< garbage_block_header* >( block )->size_;
+            put_to_garbage( std::min( garbage_bin_index( block_size ), garbage_bin_count_ - 1 ), block, block );
+        }
+
+
+        /** Provides states of current thread
+
+        @retval hook keeping states of current thread
+        @throw never
+        */
+        static thread_hook& local_hook() noexcept
+        {
+            static thread_local thread_hook hook;
+            return hook;
+        }
+
+
+        /** Looks for state of current thread without registering new one
+
+        @retval pointer to state of current thread or nullptr if the thread has not got one
+        @throw never
+        */
+        thread_state* find_local_state() const noexcept
+        {
+            auto& hook = local_hook();
+            if ( !hook.alive_ ) return nullptr;
+
+            auto self = reinterpret_cast< pointer_type >( this );
+            for ( auto state = hook.states_; state; state = state->thread_next_ )
+            {
+                if ( state->owner_.load( std::memory_order_acquire ) == self ) return state;
+            }
+            return nullptr;
+        }
+
+
+        /** Provides state of current thread, registers new one if necessary
+
+        @retval pointer to state of current thread or nullptr if the thread is exiting
+        @throw std::bad_alloc if memory is low
+        */
+        thread_state* local_state()
+        {
+            auto& hook = local_hook();
+            if ( !hook.alive_ ) return nullptr;
+
+            auto self = reinterpret_cast< pointer_type >( this );
+
+            // look through the states of current thread, most of time the first one is the one
+            for ( auto prev = &hook.states_; *prev; )
+            {
+                auto state = *prev;
+                auto owner = state->owner_.load( std::memory_order_acquire );
+                if ( owner == self ) return state;
+
+                if ( owner == 0 )
+                {
+                    // the resource the state belongs to is gone
+                    *prev = state->thread_next_;
+                    delete state;
+                }
+                else
+                {
+                    prev = &state->thread_next_;
+                }
+            }
+
+            // try to reuse a state left by an exited thread
+            thread_state* state = nullptr;
+            for ( auto it = threads_.load( std::memory_order_acquire ); it && !state; it = it->next_ )
+            {
+                pointer_type expected = 0;
+                if ( it->owner_.compare_exchange_strong( expected, self, std::memory_order_acq_rel, std::memory_order_relaxed ) ) state = it;
+            }
+            if ( state ) state->remote_frees_.store( 0, std::memory_order_release );
+
+            // or register new one
+            if ( !state )
+            {
+                state = new thread_state( self );
+                state->next_ = threads_.load( std::memory_order_relaxed );
+                while ( !threads_.compare_exchange_weak( state->next_, state, std::memory_order_acq_rel, std::memory_order_relaxed ) );
+            }
+
+            state->thread_next_ = hook.states_;
+            hook.states_ = state;
+            return state;
+        }
+
+
+        /** Reports internal event to Policy::on_event() and counts it if Policy::statistics is set
+
+        The event is counted in existing state of current thread, no state is registered for that, so the event
+        raised by a thread without state (e.g. exiting one, or one only releasing pieces) goes to resource counters
+
+        @param [in] e - event
+        @throw never
+        */
+        void notify( event e ) noexcept
+        {
+            Policy::on_event( e );
+
+            if constexpr ( Policy::statistics )
+            {
+                if ( auto state = find_local_state() )
+                {
+                    // only the thread itself writes its counters, so there is no need for atomic increment
+                    auto& counter = state->counters_[ static_cast< std::size_t >( e ) ];
+                    counter.store( counter.load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+                }
+                else
+                {
+                    counters_[ static_cast< std::size_t >( e ) ].fetch_add( 1, std::memory_order_relaxed );
+                }
+            }
+        }
+
+
+        /** Takes a batch of blocks from the top of a garbage bin keeping blocks of exactly the same size
+
+        @param [in] bin - index of the bin
+        @param [out] first - the first block of the batch
+        @param [out] last - the last block of the batch
+        @retval number of blocks taken
+        @throw never
+        */
+        std::size_t take_garbage_batch( size_type bin, pointer_type& first, pointer_type& last ) noexcept
+        {
+            if ( next_garbage_bin( bin ) != bin ) return 0;
+
+            // lock the bin
+            auto& head = garbage_[ bin ].head_;
+            first = wait_till_hazarded( [&]() noexcept {
+                return head.fetch_or( hazard_, std::memory_order_acq_rel ); }, this
+            );
+
+            // the bin keeps blocks of exactly the same size, so just take the batch from its top
+            auto next = first;
+            last = first;
+            std::size_t taken = 0;
+            while ( next && taken < magazine_batch_ )
+            {
+                last = next;
+                ++taken;
+                next = wait_till_hazarded( [&]() noexcept {
+                    return reinterpret_cast< garbage_block_header* >( last )->next_.load( std::memory_order_acquire ); }, this
+                );
+            }
+
+            // unlock the bin with the rest of the chain
+            head.store( next, std::memory_order_release );
+            return taken;
+        }
+
+
+        /** Takes a batch of blocks of given size from garbage and puts them to a magazine
+
+        @param [in] state - state of current thread
+        @param [in] magazine - index of the magazine, the same as index of garbage bin keeping blocks of the size
+        @throw never
+        */
+        void refill_magazine( thread_state& state, size_type magazine ) noexcept
+        {
+            pointer_type first = 0, last = 0;
+            if ( auto taken = take_garbage_batch( magazine, first, last ) )
+            {
+                reinterpret_cast< garbage_block_header* >( last )->next_.store( state.magazines_[ magazine ], std::memory_order_relaxed );
+                if ( !state.magazines_[ magazine ] ) state.magazine_tails_[ magazine ] = last;
+                state.magazines_[ magazine ] = first;
+                state.magazine_sizes_[ magazine ] += taken;
+            }
+        }
+
+
+        /** Moves all blocks cached by given thread state to garbage
+
+        @param [in] state - thread state to be flushed
+        @throw never
+        */
+        void flush_magazines( thread_state& state ) noexcept
+        {
+            for ( size_type magazine = 0; magazine < magazine_count_; ++magazine )
+            {
+                if ( state.magazines_[ magazine ] )
+                {
+                    put_to_garbage( magazine, state.magazines_[ magazine ], state.magazine_tails_[ magazine ] );
+                    state.magazines_[ magazine ] = state.magazine_tails_[ magazine ] = 0;
+                    state.magazine_sizes_[ magazine ] = 0;
+                }
+            }
+        }
+
+
+        /** Provides size of per-thread bump chunk with respect to pool block capacity
+
+        @retval size of the chunk
+        @throw never
+        */
+        static size_type tlab_chunk_size() noexcept
+        {
+            static size_type value = std::min( tlab_size_, floor( pool_block_capacity(), granularity_ ) );
+            return value;
+        }
+
+
+        /** Gives unused tail of a bump chunk back to the pool or to the garbage
+
+        @param [in] begin - beginning of the tail
+        @param [in] end - end of the tail
+        @throw never
+        */
+        void retire_chunk_tail( pointer_type begin, pointer_type end ) noexcept
+        {
+            if ( begin < end )
+            {
+                auto size = end - begin;
+                if ( !put_to_pool( begin, size ) ) put_gap_to_garbage( begin, size );
+            }
+        }
+
+
+        /** Gives unused tail of thread's bump chunk back to the pool or to the garbage
+
+        @param [in] state - thread state
+        @throw never
+        */
+        void retire_tlab( thread_state& state ) noexcept
+        {
+            retire_chunk_tail( state.tlab_, state.tlab_end_ );
+            state.tlab_ = state.tlab_end_ = 0;
+        }
+
+
+        /** Claims a bump chunk from the pool
+
+        @param [out] fresh - receives true if the chunk has never been allocated, so it is zero-filled
+        @retval the chunk and its size
+        @throw std::bad_alloc if memory is low
+        */
+        std::pair< pointer_type, size_type > claim_chunk( bool& fresh )
+        {
+            // the chunk is taken from the pool as an ordinary piece and gets carved further
+            auto chunk_bytes = static_cast< std::size_t >( tlab_chunk_size() - piece_internal_fields_size_ - piece_trailer_size_ );
+            return get_piece_block( allocate_on_pool( chunk_bytes, 1, &fresh ), chunk_bytes, 1 );
+        }
+
+
+        /** Carves a tile from current CPU's bump chunk
+
+        The chunk is shared by threads running on the CPU. If it is exhausted the calling thread claims a new one,
+        takes the tile from its beginning and installs the rest to the CPU unless another thread has done it
+        meanwhile
+
+        @param [in] tile_size - size of the tile
+        @param [out] fresh - receives true if the tile has never been allocated, so it is zero-filled
+        @retval the tile or 0 if the CPU cache is busy
+        @throw std::bad_alloc if memory is low
+        */
+        pointer_type take_from_cpu_chunk( size_type tile_size, bool& fresh )
+        {
+            pointer_type tile = 0, end = 0;
+            auto status = bump_cpu_chunk( tile_size, tile, end );
+            if ( status == cpu_busy ) return 0;
+            if ( status == cpu_done )
+            {
+                fresh = ( end & 1 ) != 0;
+                return tile;
+            }
+
+            auto [ chunk, chunk_size ] = claim_chunk( fresh );
+            auto chunk_end = chunk + chunk_size;
+            for ( auto expected = tile; true; )
+            {
+                pointer_type old_end = 0;
+                status = swap_cpu_chunk( expected, chunk + tile_size, chunk_end | ( fresh ? 1 : 0 ), old_end );
+                if ( status != cpu_done )
+                {
+                    // the CPU is busy or has got another chunk meanwhile, so the rest of the chunk is not needed
+                    retire_chunk_tail( chunk + tile_size, chunk_end );
+                    break;
+                }
+                if ( !expected ) break;
+
+                // the exhausted chunk has been detached, install the new one instead
+                retire_chunk_tail( expected, old_end & ~pointer_type( 1 ) );
+                expected = 0;
+            }
+            return chunk;
+        }
+
+
+        /** Tries to allocate a region of requested size and alignment from current thread's (or CPU's) bump chunk
+
+        Claims new chunk from the pool if the current one is exhausted. Pieces exceeding quarter of the chunk are left
+        to the pool, so the chunk tail does not waste much
+
+        @param [in] bytes - size of requested region in bytes
+        @param [in] alignment - alignment of requested region
+        @param [out] fresh - optional, receives true if the region has never been allocated, so it is zero-filled
+        @retval pointer to aligned region or nullptr if the chunk cannot serve the request
+        @throw std::bad_alloc if memory is low
+        */
+        void* allocate_on_tlab( std::size_t bytes, std::size_t alignment, bool* fresh )
+        {
+            // chunks are aligned with granularity, so no alignment gap has to be managed
+            if ( static_cast< size_type >( alignment ) > granularity_ ) return nullptr;
+            if ( ceil( piece_internal_fields_size_, alignment ) + static_cast< size_type >( bytes ) + piece_trailer_size_ > tlab_chunk_size() / 4 ) return nullptr;
+
+            if ( Policy::cpu_caches && cpu_caches_ )
+            {
+                auto aligned_offset = ceil( piece_internal_fields_size_, alignment );
+                auto tile_size = ceil( aligned_offset + static_cast< size_type >( bytes ) + piece_trailer_size_, granularity_ );
+                auto tile_fresh = false;
+                auto tile = take_from_cpu_chunk( tile_size, tile_fresh );
+                if ( !tile ) return nullptr;
+
+                auto aligned_area = tile + aligned_offset;
+                if constexpr ( !Policy::trusted_size )
+                {
+                    // fill block size field and block head pointer
+                    *reinterpret_cast< size_type* >( tile ) = tile_size;
+                    get_block_header_ptr_ref( aligned_area ) = tile;
+                }
+                set_piece_trailer( tile + tile_size );
+                notify( event::tlab_allocation );
+                if ( fresh ) *fresh = tile_fresh;
+                return reinterpret_cast< void* >( aligned_area );
+            }
+
+            auto state = local_state();
+            if ( !state ) return nullptr;
+
+            auto aligned_area = ceil( state->tlab_ + piece_internal_fields_size_, alignment );
+            auto tile = ceil( aligned_area + bytes + piece_trailer_size_, granularity_ );
+            if ( !state->tlab_ || tile > state->tlab_end_ )
+            {
+                retire_tlab( *state );
+                auto chunk_fresh = false;
+                auto [ chunk, chunk_size ] = claim_chunk( chunk_fresh );
+                state->tlab_ = chunk;
+                state->tlab_end_ = chunk + chunk_size;
+                state->tlab_fresh_ = chunk_fresh;
+
+                aligned_area = ceil( state->tlab_ + piece_internal_fields_size_, alignment );
+                tile = ceil( aligned_area + bytes + piece_trailer_size_, granularity_ );
+            }
+
+            if constexpr ( !Policy::trusted_size )
+            {
+                // fill block size field and block head pointer
+                *reinterpret_cast< size_type* >( state->tlab_ ) = tile - state->tlab_;
+                get_block_header_ptr_ref( aligned_area ) = state->tlab_;
+            }
+            set_piece_trailer( tile );
+            state->tlab_ = tile;
+            notify( event::tlab_allocation );
+            if ( fresh ) *fresh = state->tlab_fresh_;
+            return reinterpret_cast< void* >( aligned_area );
+        }
+
+
+        /** Checks if given piece is allocated on a per-thread heap
+
+        @param [in] p - pointer to the piece
+        @retval true if the piece belongs to heap range
+        @throw never
+        */
+        bool is_heap_piece( const void* p ) const noexcept
+        {
+            return in_arena( heap_arena_, heap_arena_size(), p );
+        }
+
+
+        /** Provides maximal number of pieces kept by private free list of a size class
+
+        A list keeps at most a heap block worth of pieces, the excess goes to the garbage
+
+        @param [in] cls - size class
+        @retval the number of pieces
+        @throw never
+        */
+        static constexpr size_type heap_free_limit( size_type cls ) noexcept
+        {
+            return std::max< size_type >( 1, heap_block_size_ / ( ( cls + 1 ) * granularity_ ) );
+        }
+
+
+        /** Puts heap piece to private free list of its size class, or to the garbage if the list is full
+
+        MUST be called by the thread owning the state, or when the state is locked on thread exit
+
+        @param [in] state - state of the owner
+        @param [in] block - memory block of the piece
+        @param [in] cls - size class of the piece
+        @throw never
+        */
+        void push_heap_free( thread_state& state, pointer_type block, size_type cls ) noexcept
+        {
+            if ( state.heap_free_counts_[ cls ] >= heap_free_limit( cls ) )
+            {
+                put_gap_to_garbage( block, ( cls + 1 ) * granularity_ );
+                return;
+            }
+            next_garbage_block_ref( block ).store( state.heap_frees_[ cls ], std::memory_order_relaxed );
+            state.heap_frees_[ cls ] = block;
+            ++state.heap_free_counts_[ cls ];
+        }
+
+
+        /** Moves heap pieces released by other threads to private free lists of the owner
+
+        MUST be called by the thread owning the state, or when the state is locked on thread exit. Sealing makes
+        threads releasing pieces afterwards give them to the garbage
+
+        @param [in] state - state of the owner
+        @param [in] seal - the owner is exiting
+        @throw never
+        */
+        void drain_remote_frees( thread_state& state, bool seal = false ) noexcept
+        {
+            auto block = state.remote_frees_.exchange( seal ? sealed_ : 0, std::memory_order_acquire );
+            if ( block == sealed_ ) return;
+            while ( block )
+            {
+                auto next = next_garbage_block_ref( block ).load( std::memory_order_relaxed );
+                push_heap_free( state, block, reinterpret_cast< garbage_block_header* >( block )->size_ / granularity_ - 1 );
+                block = next;
+            }
+        }
+
+
+        /** Gives unused tail of thread's heap block to private free list of fitting size class or to the garbage
+
+        @param [in] state - thread state
+        @throw never
+        */
+        void retire_heap_block( thread_state& state ) noexcept
+        {
+            if ( auto size = state.heap_limit_ - state.heap_; size > 0 )
+            {
+                if ( auto cls = size / granularity_ - 1; cls < heap_class_count_ )
+                {
+                    push_heap_free( state, state.heap_, cls );
+                }
+                else
+                {
+                    put_gap_to_garbage( state.heap_, size );
+                }
+            }
+            state.heap_ = state.heap_limit_ = 0;
+        }
+
+
+        /** Gives all the heap pieces cached by thread state to the garbage, called on thread exit
+
+        The heap blocks stay owned by the state, its remote list gets sealed, so pieces released later by other
+        threads go to the garbage as long as the state is not reused by a new thread
+
+        @param [in] state - thread state
+        @throw never
+        */
+        void flush_heap( thread_state& state ) noexcept
+        {
+            if constexpr ( heap_class_count_ > 0 )
+            {
+                retire_heap_block( state );
+                drain_remote_frees( state, true );
+                for ( size_type cls = 0; cls < heap_class_count_; ++cls )
+                {
+                    while ( auto block = state.heap_frees_[ cls ] )
+                    {
+                        state.heap_frees_[ cls ] = next_garbage_block_ref( block ).load( std::memory_order_relaxed );
+                        put_gap_to_garbage( block, ( cls + 1 ) * granularity_ );
+                    }
+                    state.heap_free_counts_[ cls ] = 0;
+                }
+            }
+        }
+
+
+        /** Tries to allocate a region of requested size and alignment from current thread's heap
+
+        Takes a piece of the size class released by the thread, otherwise takes all the pieces released by other
+        threads, otherwise carves the piece from owned heap block. Claims new heap block if the owned one is exhausted
+
+        @param [in] bytes - size of requested region in bytes
+        @param [in] alignment - alignment of requested region
+        @retval pointer to aligned region or nullptr if the request does not fit heap size classes or heap range is exhausted
+        @throw std::bad_alloc if memory is low
+        */
+        void* allocate_on_heap( std::size_t bytes, std::size_t alignment )
+        {
+            // heap blocks are aligned with granularity, so no alignment gap has to be managed
+            if ( static_cast< size_type >( alignment ) > granularity_ ) return nullptr;
+
+            auto aligned_offset = ceil( piece_internal_fields_size_, alignment );
+            auto size = ceil( aligned_offset + static_cast< size_type >( bytes ) + piece_trailer_size_, granularity_ );
+            auto cls = size / granularity_ - 1;
+            if ( cls >= heap_class_count_ ) return nullptr;
+
+            auto state = local_state();
+            if ( !state ) return nullptr;
+
+            // the remote list is touched only if private one is empty
+            auto block = state->heap_frees_[ cls ];
+            if ( !block && state->remote_frees_.load( std::memory_order_relaxed ) )
+            {
+                drain_remote_frees( *state );
+                block = state->heap_frees_[ cls ];
+            }
+
+            if ( block )
+            {
+                state->heap_frees_[ cls ] = next_garbage_block_ref( block ).load( std::memory_order_relaxed );
+                --state->heap_free_counts_[ cls ];
+            }
+            else
+            {
+                if ( state->heap_ + size > state->heap_limit_ )
+                {
+                    retire_heap_block( *state );
+                    auto heap_block = carve_arena( heap_arena_, heap_arena_size(), heap_block_size_ );
+                    if ( !heap_block ) return nullptr;
+                    reinterpret_cast< heap_block_header* >( heap_block )->owner_ = state;
+                    state->heap_ = heap_block + heap_block_header_size_;
+                    state->heap_limit_ = heap_block + heap_block_size_;
+                }
+                block = state->heap_;
+                state->heap_ += size;
+            }
+
+            auto aligned_area = block + aligned_offset;
+            if constexpr ( !Policy::trusted_size )
+            {
+                // fill block size field and block head pointer
+                *reinterpret_cast< size_type* >( block ) = size;
+                get_block_header_ptr_ref( aligned_area ) = block;
+            }
+            set_piece_trailer( block + size );
+            notify( event::heap_allocation );
+            return reinterpret_cast< void* >( aligned_area );
+        }
+
+
+        /** Gives released heap piece back to its owner
+
+        A piece released by the owner goes to its private free list, a piece released by another thread gets pushed
+        onto the owner's remote list. A piece of exited owner or of a size exceeding heap size classes (e.g. one
+        got by another thread from the garbage after exited owner flushed it) goes to the garbage. The remote list
+        of exiting owner is sealed, so a thread that has seen the owner alive cannot push onto the list nobody drains
+
+        @param [in] block - memory block of released piece
+        @param [in] size - size of the block
+        @throw never
+        */
+        void deallocate_on_heap( pointer_type block, size_type size ) noexcept
+        {
+            auto owner = reinterpret_cast< heap_block_header* >( floor( block, heap_block_size_ ) )->owner_;
+            if ( auto cls = size / granularity_ - 1; cls < heap_class_count_ )
+            {
+                if ( owner == find_local_state() )
+                {
+                    push_heap_free( *owner, block, cls );
+                    return;
+                }
+
+                // locked or detached state means the owner is exiting or gone
+                if ( owner->owner_.load( std::memory_order_acquire ) == reinterpret_cast< pointer_type >( this ) )
+                {
+                    reinterpret_cast< garbage_block_header* >( block )->size_ = size;
+                    auto head = owner->remote_frees_.load( std::memory_order_acquire );
+                    while ( head != sealed_ )
+                    {
+                        next_garbage_block_ref( block ).store( head, std::memory_order_relaxed );
+                        if ( owner->remote_frees_.compare_exchange_weak( head, block, std::memory_order_release, std::memory_order_acquire ) )
+                        {
+                            notify( event::remote_free );
+                            return;
+                        }
+                    }
+                }
+            }
+            put_gap_to_garbage( block, size );
+        }
+
+
+#ifdef LFMR_RSEQ
+        /** Provides Linux restartable sequences (rseq) area of current thread registered by glibc 2.35+
+
+        A thread can register a single area, so registering another one would break glibc and any other rseq user in
+        the process. The area is located by __rseq_offset from the thread pointer
+
+        @retval the area
+        @throw never
+        */
+        static struct rseq* rseq_area() noexcept
+        {
+            return reinterpret_cast< struct rseq* >( reinterpret_cast< char* >( __builtin_thread_pointer() ) + __rseq_offset );
+        }
+#endif
+
+
+        /** Provides index of CPU current thread runs on as kept by rseq area
+
+        Zero __rseq_size means glibc has not registered the area (e.g. disabled by tunable), negative CPU index means
+        the registration has failed for the thread
+
+        @retval index of the CPU or negative value if rseq is not available
+        @throw never
+        */
+        static std::int32_t current_cpu() noexcept
+        {
+#ifdef LFMR_RSEQ
+            if ( __rseq_size > 0 ) return static_cast< std::int32_t >( reinterpret_cast< volatile struct rseq* >( rseq_area() )->cpu_id );
+#endif
+            return -1;
+        }
+
+
+        /** Provides number of CPUs the system could ever run, so every CPU index fits
+
+        @retval number of CPUs
+        @throw never
+        */
+        static size_type possible_cpu_count() noexcept
+        {
+#ifdef _WIN32
+            auto count = static_cast< size_type >( std::thread::hardware_concurrency() );
+#else
+            auto count = static_cast< size_type >( sysconf( _SC_NPROCESSORS_CONF ) );
+#endif
+            return std::max< size_type >( 1, count );
+        }
+
+
+        /** Checks if CPU caches could be modified by rseq critical sections
+
+        The sections need rseq area registered by glibc and expedited rseq membarrier, the latter lets a thread
+        taking busy_ flag of a cache to restart sections running on the CPU meanwhile. The process gets registered
+        for the membarrier at the first call
+
+        @retval true if the critical sections are available
+        @throw never
+        */
+        static bool rseq_critical_sections() noexcept
+        {
+#ifdef LFMR_RSEQ_CRITICAL_SECTIONS
+            static const bool value = []() noexcept {
+                if ( __rseq_size == 0 ) return false;
+                auto commands = syscall( __NR_membarrier, MEMBARRIER_CMD_QUERY, 0, 0 );
+                return commands > 0 && ( commands & MEMBARRIER_CMD_PRIVATE_EXPEDITED_RSEQ ) != 0 &&
+                    syscall( __NR_membarrier, MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED_RSEQ, 0, 0 ) == 0;
+            }();
+            return value;
+#else
+            return false;
+#endif
+        }
+
+
+        /** Restarts rseq critical sections running on given CPU, so the ones started after see its cache busy
+
+        Fences all the CPUs of the process if the kernel cannot target a single one
+
+        @param [in] cpu - index of the CPU
+        @retval true if the sections have been restarted
+        @throw never
+        */
+        static bool fence_cpu( [[maybe_unused]] std::int32_t cpu ) noexcept
+        {
+#ifdef LFMR_RSEQ_CRITICAL_SECTIONS
+            return syscall( __NR_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED_RSEQ, MEMBARRIER_CMD_FLAG_CPU, cpu ) == 0 ||
+                syscall( __NR_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED_RSEQ, 0, 0 ) == 0;
+#else
+            return true;
+#endif
+        }
+
+
+        /** Modifies cache of CPU current thread runs on
+
+        If rseq critical sections are available the modification is done by given section, which needs no atomic
+        read-modify-write, and restarted if it has been aborted by preemption, signal or migration. Otherwise the
+        cache is locked by a single exchange of busy_ flag, the call does not wait for the cache to get unlocked, so
+        lock freedom is kept even if the thread holding it has been preempted
+
+        @param [in] critical_section - callable object accepting the cache and CPU index and returning status
+        @param [in] operation - callable object accepting the locked cache and returning status
+        @retval status of the modification
+        @throw never
+        */
+        template < typename CriticalSectionType, typename OperationType >
+        cpu_status modify_cpu_cache( CriticalSectionType&& critical_section, OperationType&& operation ) noexcept
+        {
+            while ( true )
+            {
+                auto cpu = current_cpu();
+                if ( cpu < 0 || cpu >= cpu_cache_count_ ) return cpu_busy;
+
+                auto& cache = cpu_caches_[ cpu ];
+                if ( cpu_fence_ )
+                {
+                    auto status = critical_section( cache, cpu );
+                    if ( status == cpu_retry ) continue;
+                    return status;
+                }
+
+                if ( cache.busy_.load( std::memory_order_relaxed ) || cache.busy_.exchange( 1, std::memory_order_acquire ) ) return cpu_busy;
+                auto status = operation( cache );
+                cache.busy_.store( 0, std::memory_order_release );
+                return status;
+            }
+        }
+
+
+        /** Pops a block from a magazine of current CPU
+
+        @param [in] magazine - index of the magazine
+        @param [out] block - the block
+        @retval cpu_done, cpu_failed if the magazine is empty or cpu_busy
+        @throw never
+        */
+        cpu_status pop_from_cpu_magazine( size_type magazine, pointer_type& block ) noexcept
+        {
+            return modify_cpu_cache(
+                [&]( [[maybe_unused]] cpu_cache& cache, [[maybe_unused]] std::int32_t cpu ) noexcept {
+                    auto status = static_cast< int >( cpu_busy );
+#ifdef LFMR_RSEQ_CRITICAL_SECTIONS
+                    pointer_type tmp;
+                    asm volatile( LFMR_RSEQ_BEGIN LFMR_RSEQ_POP LFMR_RSEQ_END
+                        : [status] "=&r"( status ), [value] "=&r"( block ), [tmp] "=&r"( tmp )
+                        : [rseq] "r"( rseq_area() ), [cpu] "r"( cpu ), [cache] "r"( &cache ), [busy] "i"( offsetof( cpu_cache, busy_ ) ),
+                          [size] "r"( &cache.magazine_sizes_[ magazine ] ), [slots] "r"( cache.magazines_[ magazine ] ), [sig] "i"( LFMR_RSEQ_SIG )
+                        : "memory", "cc" );
+#endif
+                    return static_cast< cpu_status >( status );
+                },
+                [&]( cpu_cache& cache ) noexcept {
+                    auto size = cache.magazine_sizes_[ magazine ].load( std::memory_order_relaxed );
+                    if ( !size ) return cpu_failed;
+                    block = cache.magazines_[ magazine ][ size - 1 ];
+                    cache.magazine_sizes_[ magazine ].store( size - 1, std::memory_order_relaxed );
+                    return cpu_done;
+                }
+            );
+        }
+
+
+        /** Pushes a block to a magazine of current CPU
+
+        @param [in] magazine - index of the magazine
+        @param [in] block - the block
+        @retval cpu_done, cpu_failed if the magazine is full or cpu_busy
+        @throw never
+        */
+        cpu_status push_to_cpu_magazine( size_type magazine, pointer_type block ) noexcept
+        {
+            return modify_cpu_cache(
+                [&]( [[maybe_unused]] cpu_cache& cache, [[maybe_unused]] std::int32_t cpu ) noexcept {
+                    auto status = static_cast< int >( cpu_busy );
+#ifdef LFMR_RSEQ_CRITICAL_SECTIONS
+                    pointer_type tmp;
+                    asm volatile( LFMR_RSEQ_BEGIN LFMR_RSEQ_PUSH LFMR_RSEQ_END
+                        : [status] "=&r"( status ), [tmp] "=&r"( tmp )
+                        : [rseq] "r"( rseq_area() ), [cpu] "r"( cpu ), [cache] "r"( &cache ), [busy] "i"( offsetof( cpu_cache, busy_ ) ),
+                          [size] "r"( &cache.magazine_sizes_[ magazine ] ), [slots] "r"( cache.magazines_[ magazine ] ),
+                          [capacity] "r"( static_cast< size_type >( Policy::magazine_size ) ), [value] "r"( block ), [sig] "i"( LFMR_RSEQ_SIG )
+                        : "memory", "cc" );
+#endif
+                    return static_cast< cpu_status >( status );
+                },
+                [&]( cpu_cache& cache ) noexcept {
+                    auto size = cache.magazine_sizes_[ magazine ].load( std::memory_order_relaxed );
+                    if ( size >= static_cast< size_type >( Policy::magazine_size ) ) return cpu_failed;
+                    cache.magazines_[ magazine ][ size ] = block;
+                    cache.magazine_sizes_[ magazine ].store( size + 1, std::memory_order_relaxed );
+                    return cpu_done;
+                }
+            );
+        }
+
+
+        /** Carves a tile from the chunk of current CPU
+
+        @param [in] tile_size - size of the tile
+        @param [out] tile - the tile if carved, otherwise bump pointer of the chunk as seen, 0 if there is no chunk
+        @param [out] end - end of the chunk, the lowest bit is set if the chunk is zero-filled
+        @retval cpu_done, cpu_failed if the chunk is missing or exhausted or cpu_busy
+        @throw never
+        */
+        cpu_status bump_cpu_chunk( size_type tile_size, pointer_type& tile, pointer_type& end ) noexcept
+        {
+            return modify_cpu_cache(
+                [&]( [[maybe_unused]] cpu_cache& cache, [[maybe_unused]] std::int32_t cpu ) noexcept {
+                    auto status = static_cast< int >( cpu_busy );
+#ifdef LFMR_RSEQ_CRITICAL_SECTIONS
+                    pointer_type tmp;
+                    asm volatile( LFMR_RSEQ_BEGIN LFMR_RSEQ_BUMP LFMR_RSEQ_END
+                        : [status] "=&r"( status ), [value] "=&r"( tile ), [aux] "=&r"( end ), [tmp] "=&r"( tmp )
+                        : [rseq] "r"( rseq_area() ), [cpu] "r"( cpu ), [cache] "r"( &cache ), [busy] "i"( offsetof( cpu_cache, busy_ ) ),
+                          [bump] "i"( offsetof( cpu_cache, bump_ ) ), [end] "i"( offsetof( cpu_cache, bump_end_ ) ), [bytes] "r"( tile_size ),
+                          [sig] "i"( LFMR_RSEQ_SIG )
+                        : "memory", "cc" );
+#endif
+                    return static_cast< cpu_status >( status );
+                },
+                [&]( cpu_cache& cache ) noexcept {
+                    tile = cache.bump_.load( std::memory_order_relaxed );
+                    if ( !tile ) return cpu_failed;
+                    end = cache.bump_end_.load( std::memory_order_relaxed );
+                    if ( ( end & ~pointer_type( 1 ) ) - tile < tile_size ) return cpu_failed;
+                    cache.bump_.store( tile + tile_size, std::memory_order_relaxed );
+                    return cpu_done;
+                }
+            );
+        }
+
+
+        /** Installs a chunk to current CPU if it has none or detaches the chunk of current CPU
+
+        @param [in] expected - bump pointer of the chunk to be detached or 0 if a new chunk has to be installed
+        @param [in] chunk - the new chunk, ignored if the chunk is detached
+        @param [in] end - end of the new chunk, the lowest bit is set if the chunk is zero-filled
+        @param [out] old_end - end of the detached chunk
+        @retval cpu_done, cpu_failed if bump pointer of the CPU differs from expected one or cpu_busy
+        @throw never
+        */
+        cpu_status swap_cpu_chunk( pointer_type expected, pointer_type chunk, pointer_type end, pointer_type& old_end ) noexcept
+        {
+            auto new_bump = expected ? 0 : chunk;
+            return modify_cpu_cache(
+                [&]( [[maybe_unused]] cpu_cache& cache, [[maybe_unused]] std::int32_t cpu ) noexcept {
+                    auto status = static_cast< int >( cpu_busy );
+#ifdef LFMR_RSEQ_CRITICAL_SECTIONS
+                    pointer_type tmp;
+                    asm volatile( LFMR_RSEQ_BEGIN LFMR_RSEQ_SWAP_CHUNK LFMR_RSEQ_END
+                        : [status] "=&r"( status ), [aux] "=&r"( old_end ), [tmp] "=&r"( tmp )
+                        : [rseq] "r"( rseq_area() ), [cpu] "r"( cpu ), [cache] "r"( &cache ), [busy] "i"( offsetof( cpu_cache, busy_ ) ),
+                          [bump] "i"( offsetof( cpu_cache, bump_ ) ), [end] "i"( offsetof( cpu_cache, bump_end_ ) ),
+                          [expected] "r"( expected ), [new_bump] "r"( new_bump ), [new_end] "r"( end ), [sig] "i"( LFMR_RSEQ_SIG )
+                        : "memory", "cc" );
+#endif
+                    return static_cast< cpu_status >( status );
+                },
+                [&]( cpu_cache& cache ) noexcept {
+                    if ( cache.bump_.load( std::memory_order_relaxed ) != expected ) return cpu_failed;
+                    old_end = cache.bump_end_.load( std::memory_order_relaxed );
+                    if ( !expected ) cache.bump_end_.store( end, std::memory_order_relaxed );
+                    cache.bump_.store( new_bump, std::memory_order_relaxed );
+                    return cpu_done;
+                }
+            );
+        }
+
+
+        /** Locks cache of given CPU waiting for the thread holding it, so no operation on the cache runs meanwhile
+
+        @param [in] cpu - index of the CPU
+        @retval true if the cache is locked, false if running critical sections cannot be restarted
+        @throw never
+        */
+        bool lock_cpu_cache( size_type cpu ) noexcept
+        {
+            auto& cache = cpu_caches_[ cpu ];
+            while ( cache.busy_.exchange( 1, std::memory_order_acquire ) ) std::this_thread::yield();
+            if ( !cpu_fence_ || fence_cpu( static_cast< std::int32_t >( cpu ) ) ) return true;
+            cache.busy_.store( 0, std::memory_order_release );
+            return false;
+        }
+
+
+        /** Moves blocks and chunks cached by all the CPUs to garbage
+
+        @throw never
+        */
+        void flush_cpu_caches() noexcept
+        {
+            for ( size_type cpu = 0; cpu < cpu_cache_count_; ++cpu )
+            {
+                if ( !lock_cpu_cache( cpu ) ) continue;
+
+                auto& cache = cpu_caches_[ cpu ];
+                for ( size_type magazine = 0; magazine < magazine_count_; ++magazine )
+                {
+                    if ( auto size = cache.magazine_sizes_[ magazine ].load( std::memory_order_relaxed ) )
+                    {
+                        auto& blocks = cache.magazines_[ magazine ];
+                        for ( size_type i = 1; i < size; ++i ) next_garbage_block_ref( blocks[ i - 1 ] ).store( blocks[ i ], std::memory_order_relaxed );
+                        put_to_garbage( magazine, blocks[ 0 ], blocks[ size - 1 ] );
+                        cache.magazine_sizes_[ magazine ].store( 0, std::memory_order_relaxed );
+                    }
+                }
+                if ( auto bump = cache.bump_.load( std::memory_order_relaxed ) )
+                {
+                    retire_chunk_tail( bump, cache.bump_end_.load( std::memory_order_relaxed ) & ~pointer_type( 1 ) );
+                    cache.bump_.store( 0, std::memory_order_relaxed );
+                    cache.bump_end_.store( 0, std::memory_order_relaxed );
+                }
+
+                cache.busy_.store( 0, std::memory_order_release );
+            }
+        }
+
+
+        /** Takes a block from a magazine of current CPU, refills the magazine from garbage if it is empty
+
+        @param [in] magazine - index of the magazine
+        @retval the block or 0 if the magazine cannot serve the request
+        @throw never
+        */
+        pointer_type take_from_cpu_magazine( size_type magazine ) noexcept
+        {
+            pointer_type block = 0;
+            auto status = pop_from_cpu_magazine( magazine, block );
+            if ( status == cpu_done ) return block;
+            if ( status == cpu_busy ) return 0;
+
+            // the first block of the batch is taken, the rest ones refill the magazine till it gets full
+            pointer_type first = 0, last = 0;
+            if ( !take_garbage_batch( magazine, first, last ) ) return 0;
+            for ( auto next = first; next != last; )
+            {
+                auto rest = next_garbage_block_ref( next ).load( std::memory_order_relaxed );
+                if ( push_to_cpu_magazine( magazine, rest ) != cpu_done )
+                {
+                    put_to_garbage( magazine, rest, last );
+                    break;
+                }
+                next = rest;
+            }
+            return first;
+        }
+
+
+        /** Puts released block to a magazine of current CPU, moves half of the magazine to garbage if it is full
+
+        @param [in] block - released block
+        @param [in] magazine - index of the magazine
+        @retval true if the block has been cached or moved to garbage
+        @throw never
+        */
+        bool put_to_cpu_magazine( pointer_type block, size_type magazine ) noexcept
+        {
+            auto status = push_to_cpu_magazine( magazine, block );
+            if ( status == cpu_done ) return true;
+            if ( status == cpu_busy ) return false;
+
+            // the block and a batch popped from the full magazine go to garbage at once
+            auto last = block;
+            for ( std::size_t taken = 0; taken < magazine_batch_; ++taken )
+            {
+                pointer_type popped = 0;
+                if ( pop_from_cpu_magazine( magazine, popped ) != cpu_done ) break;
+                next_garbage_block_ref( last ).store( popped, std::memory_order_relaxed );
+                last = popped;
+            }
+            put_to_garbage( magazine, block, last );
+            return true;
+        }
+
+
+        /** Takes a block from a magazine, refills the magazine from garbage if it is empty
+
+        @param [in] state - state of current thread
+        @param [in] magazine - index of the magazine
+        @retval the block or 0 if neither the magazine nor garbage keeps blocks of the size
+        @throw never
+        */
+        pointer_type take_from_magazine( thread_state& state, size_type magazine ) noexcept
+        {
+            if ( !state.magazines_[ magazine ] ) refill_magazine( state, magazine );
+
+            auto block = state.magazines_[ magazine ];
+            if ( block )
+            {
+                state.magazines_[ magazine ] = reinterpret_cast< garbage_block_header* >( block )->next_.load( std::memory_order_relaxed );
+                --state.magazine_sizes_[ magazine ];
+            }
+            return block;
+        }
+
+
+        /** Puts released block to a magazine, moves the whole magazine to garbage if it gets full
+
+        @param [in] state - state of current thread
+        @param [in] block - released block
+        @param [in] magazine - index of the magazine
+        @throw never
+        */
+        void put_to_magazine( thread_state& state, pointer_type block, size_type magazine ) noexcept
+        {
+            reinterpret_cast< garbage_block_header* >( block )->next_.store( state.magazines_[ magazine ], std::memory_order_relaxed );
+            if ( !state.magazines_[ magazine ] ) state.magazine_tails_[ magazine ] = block;
+            state.magazines_[ magazine ] = block;
+
+            // full magazine goes to garbage at once
+            if ( ++state.magazine_sizes_[ magazine ] >= Policy::magazine_size )
+            {
+                put_to_garbage( magazine, state.magazines_[ magazine ], state.magazine_tails_[ magazine ] );
+                state.magazines_[ magazine ] = state.magazine_tails_[ magazine ] = 0;
+                state.magazine_sizes_[ magazine ] = 0;
+            }
+        }
+
+
+        /** Tries to allocate a region of requested size and alignment from current thread's (or CPU's) magazine
+
+        @param [in] bytes - size of requested region in bytes
+        @param [in] alignment - alignment of requested region
+        @retval pointer to aligned region or nullptr if magazines cannot serve the request
+        @throw std::bad_alloc if memory is low
+        */
+        void* allocate_on_magazine( std::size_t bytes, std::size_t alignment )
+        {
+            // garbage blocks are aligned with granularity, so the block size depends on requested size and alignment only
+            if ( static_cast< size_type >( alignment ) > granularity_ ) return nullptr;
+            auto aligned_offset = ceil( piece_internal_fields_size_, alignment );
+            auto magazine = ceil( aligned_offset + bytes + piece_trailer_size_, granularity_ ) / granularity_ - 1;
+            if ( magazine >= magazine_count_ ) return nullptr;
+
+            pointer_type block = 0;
+            if ( Policy::cpu_caches && cpu_caches_ )
+            {
+                block = take_from_cpu_magazine( magazine );
+            }
+            else
+            {
+                auto state = local_state();
+                if ( !state ) return nullptr;
+                block = take_from_magazine( *state, magazine );
+            }
+            if ( !block ) return nullptr;
+
+            // fill <block head ptr> field
+            auto aligned_area = block + aligned_offset;
+            if constexpr ( !Policy::trusted_size ) get_block_header_ptr_ref( aligned_area ) = block;
+            set_piece_trailer( block + ( magazine + 1 ) * granularity_ );
+            return reinterpret_cast< void* >( aligned_area );
+        }
+
+
+        /** Tries to put released block into current thread's (or CPU's) magazine
+
+        @param [in] block - released block
+        @param [in] block_size - size of the block
+        @retval true if the block has been cached
+        @throw std::bad_alloc if memory is low
+        */
+        bool deallocate_to_magazine( pointer_type block, size_type block_size )
+        {
+            auto magazine = block_size / granularity_ - 1;
+            if ( magazine >= magazine_count_ ) return false;
+
+            if ( Policy::cpu_caches && cpu_caches_ ) return put_to_cpu_magazine( block, magazine );
+
+            auto state = local_state();
+            if ( !state ) return false;
+            put_to_magazine( *state, block, magazine );
+            return true;
+        }
+
+
+        /** Provides reference to next block pointer of a garbage block
+
+        @param [in] block - garbage block
+        @retval reference to next block pointer
+        @throw never
+        */
+        static std::atomic< pointer_type >& next_garbage_block_ref( pointer_type block ) noexcept
+        {
+            assert( block );
+            return reinterpret_cast< garbage_block_header* >( block )->next_;
+        }
+
+
+        /** Sorts a chain of garbage blocks owned by current thread by address
+
+        @param [in] chain - the first block of the chain
+        @retval the first block of sorted chain
+        @throw never
+        */
+        static pointer_type sort_garbage_chain( pointer_type chain ) noexcept
+        {
+            if ( !chain || !next_garbage_block_ref( chain ).load( std::memory_order_relaxed ) ) return chain;
+
+            // split the chain in halves
+            auto middle = chain;
+            for ( auto fast = next_garbage_block_ref( chain ).load( std::memory_order_relaxed ); fast; )
+            {
+                if ( ( fast = next_garbage_block_ref( fast ).load( std::memory_order_relaxed ) ) )
+                {
+                    middle = next_garbage_block_ref( middle ).load( std::memory_order_relaxed );
+                    fast = next_garbage_block_ref( fast ).load( std::memory_order_relaxed );
+                }
+            }
+            auto second = next_garbage_block_ref( middle ).load( std::memory_order_relaxed );
+            next_garbage_block_ref( middle ).store( 0, std::memory_order_relaxed );
+
+            // sort the halves and merge them
+            auto first = sort_garbage_chain( chain );
+            second = sort_garbage_chain( second );
+
+            pointer_type head = 0, tail = 0;
+            while ( first || second )
+            {
+                auto& taken = ( !second || ( first && first < second ) ) ? first : second;
+                if ( tail ) next_garbage_block_ref( tail ).store( taken, std::memory_order_relaxed ); else head = taken;
+                tail = taken;
+                taken = next_garbage_block_ref( taken ).load( std::memory_order_relaxed );
+            }
+            next_garbage_block_ref( tail ).store( 0, std::memory_order_relaxed );
+
+            return head;
+        }
+
+
+        /** Detaches all the blocks from garbage
+
+        Blocks are not handed over immediately, allocating threads that has already locked a block in a bin could
+        be still walking through, so every block becomes owned only after its next pointer gets unlocked
+
+        @retval unsorted chain of detached blocks
+        @throw never
+        */
+        pointer_type detach_garbage() noexcept
+        {
+            pointer_type chain = 0;
+            for ( auto bin = next_garbage_bin( 0 ); bin < garbage_bin_count_; bin = next_garbage_bin( bin + 1 ) )
+            {
+                // lock the bin, mark it empty and unlock
+                auto& head = garbage_[ bin ].head_;
+                auto block = wait_till_hazarded( [&]() noexcept {
+                    return head.fetch_or( hazard_, std::memory_order_acq_rel ); }, this
+                );
+                garbage_bitmap_[ bin / 64 ].fetch_and( ~( std::uint64_t( 1 ) << ( bin % 64 ) ), std::memory_order_acq_rel );
+                head.store( 0, std::memory_order_release );
+
+                // follow walking threads and collect the blocks
+                while ( block )
+                {
+                    auto next = wait_till_hazarded( [&]() noexcept {
+                        return next_garbage_block_ref( block ).load( std::memory_order_acquire ); }, this
+                    );
+                    next_garbage_block_ref( block ).store( chain, std::memory_order_relaxed );
+                    chain = block;
+                    block = next;
+                }
+            }
+            return chain;
+        }
+
+
+        /** Tries to give released block back to unallocated area of its pool block
+
+        @param [in] block - released block
+        @param [in] size - size of the block
+        @retval true if the block is adjacent to unallocated area of a pool block and has been merged with it
+        @throw never
+        */
+        bool put_to_pool( pointer_type block, size_type size ) noexcept
+        {
+            for ( auto pool_block = pool_.load( std::memory_order_acquire ); pool_block; pool_block = reinterpret_cast< pool_block_header* >( pool_block )->next_ )
+            {
+                auto& header = *reinterpret_cast< pool_block_header* >( pool_block );
+                if ( auto unallocated = header.unallocated_.load( std::memory_order_acquire ); unallocated == block + size )
+                {
+                    mark_used( header, unallocated );
+
+                    // fails if another thread has just allocated the area
+                    if ( !header.unallocated_.compare_exchange_strong( unallocated, block, std::memory_order_acq_rel, std::memory_order_relaxed ) ) return false;
+
+                    // given back area is not clean anymore
+                    if ( header.dirty_.load( std::memory_order_relaxed ) < unallocated ) header.dirty_.store( unallocated, std::memory_order_release );
+                    return true;
+                }
+            }
+            return false;
+        }
+
+
+        /** Returns physical memory of given garbage block to OS, except the page keeping block header
+
+        @param [in] block - garbage block owned by current thread
+        @retval number of bytes returned to OS
+        @throw never
+        */
+        static size_type purge_garbage_block( pointer_type block ) noexcept
+        {
+            auto& header = *reinterpret_cast< garbage_block_header* >( block );
+            auto begin = ceil( block + garbage_block_header_size, system_page_size() );
+            auto end = floor( block + header.size_, system_page_size() );
+            header.stamp_ = 0;
+            if ( begin >= end ) return 0;
+            virtual_purge( reinterpret_cast< void* >( begin ), end - begin );
+            return end - begin;
+        }
+
+
+        /** Returns physical memory of given back unallocated areas of pool blocks to OS
+
+        @retval number of bytes returned to OS
+        @throw never
+        */
+        size_type purge_pool() noexcept
+        {
+            size_type purged = 0;
+            for ( auto pool_block = pool_.load( std::memory_order_acquire ); pool_block; pool_block = reinterpret_cast< pool_block_header* >( pool_block )->next_ )
+            {
+                auto& header = *reinterpret_cast< pool_block_header* >( pool_block );
+                auto unallocated = header.unallocated_.load( std::memory_order_acquire );
+                auto dirty = header.dirty_.load( std::memory_order_acquire );
+                if ( dirty <= unallocated ) continue;
+
+                // take unallocated area, so nobody could allocate it meanwhile
+                if ( !header.unallocated_.compare_exchange_strong( unallocated, pool_block + header.size_, std::memory_order_acq_rel, std::memory_order_relaxed ) ) continue;
+
+                auto begin = ceil( unallocated, system_page_size() );
+                auto end = floor( dirty, system_page_size() );
+                if ( begin < end )
+                {
+                    virtual_purge( reinterpret_cast< void* >( begin ), end - begin );
+                    purged += end - begin;
+                }
+
+                // and give it back
+                header.dirty_.store( unallocated, std::memory_order_relaxed );
+                header.unallocated_.store( unallocated, std::memory_order_release );
+            }
+            return purged;
+        }
+
+
+        /** Results of garbage maintenance */
+        struct maintenance_result
+        {
+            bool merged_ = false;                       //< at least one block has been merged
+            size_type purged_ = 0;                      //< number of bytes returned to OS
+        };
+
+
+        /** Detaches the garbage, merges adjacent blocks, returns physical memory of idle blocks to OS and puts the blocks back
+
+        If another thread is maintaining the garbage the call returns immediately
+
+        @param [in] merge - merge adjacent blocks
+        @param [in] released_before - return physical memory of blocks released before the moment, 0 disables purging
+        @retval maintenance results
+        @throw never
+        */
+        maintenance_result maintain_garbage( bool merge, std::int64_t released_before ) noexcept
+        {
+            maintenance_result result;
+            if ( maintenance_.exchange( true, std::memory_order_acquire ) ) return result;
+
+            auto chain = detach_garbage();
+            if ( merge ) chain = sort_garbage_chain( chain );
+
+            for ( auto block = chain; block; )
+            {
+                auto& header = *reinterpret_cast< garbage_block_header* >( block );
+                auto next = header.next_.load( std::memory_order_relaxed );
+
+                // absorb following adjacent blocks
+                for ( ; merge && next && block + header.size_ == next; result.merged_ = true )
+                {
+                    auto& next_header = *reinterpret_cast< garbage_block_header* >( next );
+                    header.size_ += next_header.size_;
+                    header.stamp_ = std::max( header.stamp_, next_header.stamp_ );
+                    next = next_header.next_.load( std::memory_order_relaxed );
+                }
+
+                if ( merge && put_to_pool( block, header.size_ ) )
+                {
+                    result.merged_ = true;
+                }
+                else
+                {
+                    if ( header.stamp_ && header.stamp_ < released_before ) result.purged_ += purge_garbage_block( block );
+                    put_to_garbage( block );
+                }
+
+                block = next;
+            }
+
+            if ( released_before ) result.purged_ += purge_pool();
+
+            maintenance_.store( false, std::memory_order_release );
+            return result;
+        }
+
+
+        /** Returns memory idle longer than Policy::purge_decay to OS if it's time to do that
+
+        @param [in] now - current time stamp
+        @throw never
+        */
+        void purge_on_decay( std::int64_t now ) noexcept
+        {
+            using decay_type = std::chrono::duration< std::int64_t, std::chrono::steady_clock::period >;
+            constexpr auto decay = std::chrono::duration_cast< decay_type >( std::chrono::milliseconds( Policy::purge_decay ) ).count();
+
+            // only one thread does the job
+            auto next_purge = next_purge_.load( std::memory_order_relaxed );
+            if ( now < next_purge || !next_purge_.compare_exchange_strong( next_purge, now + decay, std::memory_order_relaxed ) ) return;
+
+            maintain_garbage( Policy::coalescing, now - decay );
+        }
+
+
+        /** Checks requested size and alignment
+
+        @param [in] bytes - requested size
+        @param [in] alignment - requested alignment
+        @throw std::invalid_argument if size is zero or alignment is not a power of two or does not fit size_type
+        */
+        static void check_request( std::size_t bytes, std::size_t alignment )
+        {
+            if ( !bytes )
+            {
+                throw std::invalid_argument( "azul::lock_free_memory_resource::do_allocate(): invalid requested size" );
+            }
+
+            // check alignment
+            if ( !alignment ||
+                ( alignment & ( alignment - 1 ) ) != 0 ||
+                alignment > static_cast< std::size_t >( std::numeric_limits< size_type >::max() ) )
+            {
+                throw std::invalid_argument( "azul::lock_free_memory_resource::do_allocate(): invalid requested alignment" );
+            }
+        }
+
+
+        /** Gives released slab piece back to its size class
+
+        @param [in] p - released piece
+        @throw never
+        */
+        void deallocate_on_slab( void* p ) noexcept
+        {
+            // size class is kept by header of the run
+            auto piece = reinterpret_cast< pointer_type >( p );
+            auto size = reinterpret_cast< slab_run_header* >( floor( piece, slab_run_size() ) )->size_;
+            put_to_slab( slabs_[ size / slab_quantum_ - 1 ], piece, piece );
+        }
+
+
+        /** Provides memory block of released piece
+
+        If Policy::trusted_size is set the block is calculated from passed size and alignment
+
+        @param [in] p - released piece
+        @param [in] bytes - size passed to deallocate()
+        @param [in] alignment - alignment passed to deallocate()
+        @retval pointer to the block and its size
+        @throw never
+        */
+        std::pair< pointer_type, size_type > get_piece_block( void* p, [[maybe_unused]] std::size_t bytes, [[maybe_unused]] std::size_t alignment ) noexcept
+        {
+            if constexpr ( Policy::trusted_size )
+            {
+                // the piece has no header, its block is calculated the same way as on allocation
+                auto block_head_ptr = reinterpret_cast< pointer_type >( p );
+                auto block_size = ceil( static_cast< size_type >( bytes ) + piece_trailer_size_, granularity_ );
+                if ( required_pool_block_size( bytes, alignment ) > pool_block_size() )
+                {
+                    block_head_ptr -= large_piece_offset( alignment );
+                    block_size = large_block_size( bytes, alignment );
+                }
+                assert( check_piece_trailer( block_head_ptr + block_size ) && "size passed to deallocate() does not match allocated one" );
+                return { block_head_ptr, block_size };
+            }
+            else
+            {
+                auto block_head_ptr = get_block_header_ptr_ref( reinterpret_cast< pointer_type >( p ) );
+                return { block_head_ptr, *reinterpret_cast< size_type* >( block_head_ptr ) };
+            }
+        }
+
+
+        /** Releases large block back to OS
+
+        @param [in] block - the block
+        @param [in] block_size - size of the block
+        @throw never
+        */
+        void deallocate_large_block( pointer_type block, size_type block_size ) noexcept
+        {
+            unregister_large_block( block );
+            large_bytes_.fetch_sub( block_size, std::memory_order_relaxed );
+            large_count_.fetch_sub( 1, std::memory_order_relaxed );
+
+            if constexpr ( large_cache_bucket_count_ > 0 )
+            {
+                if ( cache_large_block( block, block_size ) ) return;
+            }
+
+            virtual_free( reinterpret_cast< void* >( block ), block_size );
+            notify( event::large_block_unmap );
+        }
+
+
+        /** Resizes pool piece in place
+
+        Growing piece has to end at unallocated area of its pool block, the area gets taken by a single CAS. Tail
+        of shrinking piece goes back to unallocated area if adjacent to it, otherwise to garbage
+
+        @param [in] piece - allocated piece
+        @param [in] block - memory block of the piece
+        @param [in] block_size - size of the block
+        @param [in] bytes - new size of the piece
+        @retval true if the piece has been resized
+        @throw never
+        */
+        bool resize_on_pool( pointer_type piece, pointer_type block, size_type block_size, std::size_t bytes ) noexcept
+        {
+            auto tile = block + block_size;
+            auto new_tile = ceil( piece + static_cast< size_type >( bytes ) + piece_trailer_size_, granularity_ );
+
+            if ( new_tile != tile )
+            {
+                // find pool block of the piece
+                auto pool_block = pool_.load( std::memory_order_acquire );
+                for ( ; pool_block; pool_block = reinterpret_cast< pool_block_header* >( pool_block )->next_ )
+                {
+                    auto size = reinterpret_cast< pool_block_header* >( pool_block )->size_.load( std::memory_order_acquire );
+                    if ( block >= pool_block && block < pool_block + size ) break;
+                }
+
+                if ( new_tile > tile )
+                {
+                    if ( !pool_block ) return false;
+                    auto& header = *reinterpret_cast< pool_block_header* >( pool_block );
+                    if ( new_tile > pool_block + header.size_.load( std::memory_order_acquire ) ) return false;
+                    if ( !header.unallocated_.compare_exchange_strong( tile, new_tile, std::memory_order_acq_rel, std::memory_order_relaxed ) ) return false;
+                }
+                else
+                {
+                    auto given_back = false;
+                    if ( pool_block )
+                    {
+                        auto& header = *reinterpret_cast< pool_block_header* >( pool_block );
+                        auto unallocated = tile;
+                        mark_used( header, tile );
+                        given_back = header.unallocated_.compare_exchange_strong( unallocated, new_tile, std::memory_order_acq_rel, std::memory_order_relaxed );
+                        if ( given_back && header.dirty_.load( std::memory_order_relaxed ) < tile ) header.dirty_.store( tile, std::memory_order_release );
+                    }
+                    if ( !given_back ) put_gap_to_garbage( new_tile, tile - new_tile );
+                }
+            }
+
+            if constexpr ( !Policy::trusted_size ) *reinterpret_cast< size_type* >( block ) = new_tile - block;
+            set_piece_trailer( new_tile );
+            return true;
+        }
+
+
+        /** Resizes large block by remapping
+
+        @param [in] piece - allocated piece
+        @param [in] block - large block of the piece
+        @param [in] block_size - size of the block
+        @param [in] bytes - new size of the piece
+        @param [in] alignment - alignment of the piece
+        @param [in] may_move - the block could be moved
+        @retval pointer to resized piece or 0 if the block cannot be resized
+        @throw never
+        */
+        pointer_type resize_large_block( pointer_type piece, pointer_type block, size_type block_size, std::size_t bytes, std::size_t alignment, [[maybe_unused]] bool may_move ) noexcept
+        {
+            auto new_size = large_block_size( bytes, alignment );
+            if ( new_size != block_size )
+            {
+#ifdef __linux__
+                // moved block would lose alignment exceeding page size
+                if ( static_cast< size_type >( alignment ) > system_page_size() ) may_move = false;
+
+                auto moved = ::mremap( reinterpret_cast< void* >( block ), block_size, new_size, may_move ? MREMAP_MAYMOVE : 0 );
+                if ( MAP_FAILED == moved ) return 0;
+                notify( event::large_block_remap );
+
+                auto new_block = reinterpret_cast< pointer_type >( moved );
+                update_large_block( new_block, new_size );
+                large_bytes_.fetch_add( new_size - block_size, std::memory_order_relaxed );
+                piece = new_block + ( piece - block );
+                block = new_block;
+
+                if constexpr ( !Policy::trusted_size )
+                {
+                    *reinterpret_cast< size_type* >( block ) = new_size;
+                    get_block_header_ptr_ref( piece ) = block;
+                }
+#else
+                return 0;
+#endif
+            }
+            set_piece_trailer( block + new_size );
+            return piece;
+        }
+
+
+        /** Resizes allocated piece in place or by remapping its large block
+
+        Piece cannot change its kind: a slab piece stays within its size class, a pool piece has to stay fitting
+        pool block and a large block has to stay large one
+
+        @param [in] p - allocated piece
+        @param [in] old_bytes - current size of the piece
+        @param [in] new_bytes - new size of the piece
+        @param [in] alignment - alignment of the piece
+        @param [in] may_move - large block could be moved
+        @retval pointer to resized piece or nullptr if the piece cannot be resized
+        @throw never
+        */
+        void* resize( void* p, std::size_t old_bytes, std::size_t new_bytes, std::size_t alignment, bool may_move ) noexcept
+        {
+            auto piece = reinterpret_cast< pointer_type >( p );
+
+            if constexpr ( slab_class_count_ > 0 )
+            {
+                if ( is_slab_piece( p ) )
+                {
+                    auto size = reinterpret_cast< slab_run_header* >( floor( piece, slab_run_size() ) )->size_;
+                    return static_cast< size_type >( new_bytes ) <= size ? p : nullptr;
+                }
+            }
+
+            auto [ block, block_size ] = get_piece_block( p, old_bytes, alignment );
+
+            // heap pieces keep their size class
+            if constexpr ( heap_class_count_ > 0 )
+            {
+                if ( is_heap_piece( p ) ) return ceil( piece - block + static_cast< size_type >( new_bytes ) + piece_trailer_size_, granularity_ ) == block_size ? p : nullptr;
+            }
+
+            auto large = block_size > pool_block_capacity();
+            if ( large != ( required_pool_block_size( new_bytes, alignment ) > pool_block_size() ) ) return nullptr;
+
+            if ( large ) return reinterpret_cast< void* >( resize_large_block( piece, block, block_size, new_bytes, alignment, may_move ) );
+            return resize_on_pool( piece, block, block_size, new_bytes ) ? p : nullptr;
+        }
+
+
+        /** Allocates a piece from slabs, thread heap, magazine, garbage, pool or as a large block, whatever fits first
+
+        @param [in] bytes - requested size
+        @param [in] alignment - requested alignment
+        @param [out] fresh - optional, receives true if the piece is known to be zero-filled
+        @retval pointer to allocated piece
+        @throw std::invalid_argument if size or alignment is invalid, std::bad_alloc if memory is low
+        */
+        void* allocate_piece( std::size_t bytes, std::size_t alignment, bool* fresh )
+        {
+            if ( fresh ) *fresh = false;
+            check_request( bytes, alignment );
+
+            // allocating thread gets its own state to count events in
+            if constexpr ( Policy::statistics ) local_state();
+
+            // small pieces go to slabs
+            if constexpr ( slab_class_count_ > 0 )
+            {
+                if ( auto piece = allocate_on_slab( bytes, alignment ) ) return piece;
+            }
+
+            // small pieces go to current thread's heap
+            if constexpr ( heap_class_count_ > 0 )
+            {
+                if ( auto piece = allocate_on_heap( bytes, alignment ) ) return piece;
+            }
+
+            // calculate size of pool block that could fit requested region
+            auto required_size = required_pool_block_size( bytes, alignment );
+            if ( required_size < 0 ) throw std::bad_alloc();
+
+            // if block too large to be allocated on pool
+            if ( required_size > pool_block_size() )
+            {
+                // allocate block directly in the process's virtual space
+                return allocate_large_block( bytes, alignment, fresh );
+            }
+
+            // try allocate block on current thread's magazine
+            if constexpr ( magazine_count_ > 0 )
+            {
+                if ( auto block = allocate_on_magazine( bytes, alignment ) )
+                {
+                    notify( event::magazine_allocation );
+                    return block;
+                }
+            }
+
+            // try allocate block on garbage
+            if ( auto block = allocate_on_garbage( bytes, alignment ) )
+            {
+                notify( event::garbage_allocation );
+                return block;
+            }
+            else
+            {
+                // allocate block on current thread's chunk
+                if constexpr ( tlab_size_ > 0 )
+                {
+                    if ( auto block = allocate_on_tlab( bytes, alignment, fresh ) ) return block;
+                }
+
+                // allocate block on pool
+                return allocate_on_pool( bytes, alignment, fresh );
+            }
+        }
+
+
+        /** Provides usable size of allocated piece
+
+        @param [in] p - allocated piece
+        @param [in] bytes - size passed to allocate()
+        @param [in] alignment - alignment passed to allocate()
+        @retval size of the piece up to the end of its memory block
+        @throw never
+        */
+        std::size_t usable_size( void* p, std::size_t bytes, std::size_t alignment ) noexcept
+        {
+            auto piece = reinterpret_cast< pointer_type >( p );
+
+            if constexpr ( slab_class_count_ > 0 )
+            {
+                if ( is_slab_piece( p ) ) return static_cast< std::size_t >( reinterpret_cast< slab_run_header* >( floor( piece, slab_run_size() ) )->size_ );
+            }
+
+            auto [ block, block_size ] = get_piece_block( p, bytes, alignment );
+            return static_cast< std::size_t >( block + block_size - piece_trailer_size_ - piece );
+        }
+
+
+    protected:
+
+        /** Implements virtual std::prm::memory_resource::do_allocate()
+        */
+        void* do_allocate( std::size_t bytes, std::size_t alignment ) override
+        {
+            return allocate_piece( bytes, alignment, nullptr );
+        }
+
+
+        /** Implements virtual std::prm::memory_resource::do_deallocate()
+
+        @param [in] p - pointer to region to be deallocated
+        @param [in] bytes - size of the region, used only if Policy::trusted_size is set
+        @param [in] alignment - alignment of the region, used only if Policy::trusted_size is set
+        @throw never
+        */
+        void do_deallocate( void* p, [[maybe_unused]] std::size_t bytes, [[maybe_unused]] std::size_t alignment ) override
+        {
+            if constexpr ( slab_class_count_ > 0 )
+            {
+                if ( is_slab_piece( p ) )
+                {
+                    deallocate_on_slab( p );
+                    return;
+                }
+            }
+
+            if ( p )
+            {
+                auto [ block_head_ptr, block_size ] = get_piece_block( p, bytes, alignment );
+                if ( heap_class_count_ > 0 && is_heap_piece( p ) )
+                {
+                    deallocate_on_heap( block_head_ptr, block_size );
+                }
+                else if ( block_size > pool_block_capacity() )
+                {
+                    deallocate_large_block( block_head_ptr, block_size );
+                }
+                else
+                {
+                    auto stamp = release_stamp();
+                    if constexpr ( Policy::trusted_size ) reinterpret_cast< garbage_block_header* >( block_head_ptr )->size_ = block_size;
+                    reinterpret_cast< garbage_block_header* >( block_head_ptr )->stamp_ = stamp;
+                    if constexpr ( Policy::purge_decay > 0 ) purge_on_decay( stamp );
+
+                    // try to keep block in current thread's magazine
+                    if constexpr ( magazine_count_ > 0 )
+                    {
+                        if ( deallocate_to_magazine( block_head_ptr, block_size ) ) return;
+                    }
+
+                    // prepend block to garbage ( no reason to touch <block size> field )
+                    put_to_garbage( block_head_ptr );
+                }
+            }
+        }
+
+
+        /** Implements virtual std::prm::memory_resource::do_is_equal()
+
+        @param [in] other - memory resource to be evaluated
+        @retval true if the same instance
+        */
+        bool do_is_equal( const std::pmr::memory_resource& other ) const noexcept override
+        {
+            return ( this == &other );
+        }
+
+
+        /** Implements virtual at_least_capable::do_allocate_at_least()
+
+        @param [in] bytes - requested size
+        @param [in] alignment - requested alignment
+        @retval pointer to the piece and its usable size
+        @throw std::invalid_argument if size or alignment is invalid, std::bad_alloc if memory is low
+        */
+        allocation_result do_allocate_at_least( std::size_t bytes, std::size_t alignment ) override
+        {
+            allocation_result result;
+            result.ptr_ = allocate( bytes, alignment );
+            result.count_ = usable_size( result.ptr_, bytes, alignment );
+            return result;
+        }
+
+    public:
+
+        /** Snapshot of internal event counters
+        */
+        struct statistics
+        {
+            std::uint64_t events_[ event_count_ ] = {};     //< number of events by type
+
+            std::uint64_t operator[]( event e ) const noexcept { return events_[ static_cast< std::size_t >( e ) ]; }
+        };
+
+
+        /** Snapshot of memory usage
+        */
+        struct snapshot
+        {
+            std::size_t committed_bytes_ = 0;           //< total size of virtual memory blocks held by the resource
+            std::size_t pool_block_count_ = 0;          //< number of pool blocks
+            std::size_t pool_bytes_ = 0;                //< total size of pool blocks
+            std::size_t unallocated_bytes_ = 0;         //< total size of unallocated areas of pool blocks
+            std::size_t largest_unallocated_ = 0;       //< largest unallocated area of a pool block
+            std::size_t garbage_block_count_ = 0;       //< number of released blocks in garbage
+            std::size_t garbage_bytes_ = 0;             //< total size of released blocks in garbage
+            std::size_t largest_garbage_block_ = 0;     //< largest released block in garbage
+            std::size_t large_block_count_ = 0;         //< number of allocated large blocks
+            std::size_t large_block_bytes_ = 0;         //< total size of allocated large blocks
+            std::size_t reserve_bytes_ = 0;             //< total size of pool blocks kept ready by background replenisher
+            std::size_t slab_bytes_ = 0;                //< total size of slab runs
+            std::size_t heap_bytes_ = 0;                //< total size of per-thread heap blocks
+            std::size_t large_cache_bytes_ = 0;         //< total size of released large blocks kept mapped for reuse
+            std::size_t cpu_cache_bytes_ = 0;           //< total size of released blocks and unused chunk tails cached by CPUs
+            double fragmentation_ = 0;                  //< 1 - largest free area / total free area, where free area is either unallocated or released
+        };
+
+
+        /** Position of pool bump pointer captured by checkpoint()
+        */
+        struct mark
+        {
+            pointer_type pool_block_ = 0;               //< the most recent pool block at the moment
+            pointer_type unallocated_ = 0;              //< beginning of its unallocated area at the moment
+            pointer_type tlab_ = 0;                     //< bump pointer of calling thread's chunk at the moment
+            pointer_type tlab_end_ = 0;                 //< end of calling thread's chunk
+        };
+
+
+        /** Default constructor
+
+        Allocates first pool block
+
+        @param [in] initial_buffer_size - desired size of initial pool block
+        @throw std::bad_alloc if memory is low
+        */
+        lock_free_memory_resource( std::size_t initial_buffer_size = 0 )
+        {
+            grow_pool( initial_buffer_size );
+
+            if constexpr ( Policy::cpu_caches && ( magazine_count_ > 0 || tlab_size_ > 0 ) )
+            {
+                // threads keep their own magazines and chunks if rseq is not available
+                if ( current_cpu() >= 0 )
+                {
+                    cpu_cache_count_ = possible_cpu_count();
+                    cpu_caches_ = new ( std::nothrow ) cpu_cache[ static_cast< std::size_t >( cpu_cache_count_ ) ];
+                    if ( !cpu_caches_ ) cpu_cache_count_ = 0;
+                    cpu_fence_ = rseq_critical_sections();
+                }
+            }
+
+            if constexpr ( Policy::reserve_size > 0 )
+            {
+                try
+                {
+                    replenisher_ = std::thread( [ this ]() noexcept { replenish(); } );
+                }
+                catch ( ... )
+                {
+                    // no way to start background replenisher, the pool just grows on demand
+                }
+            }
+        }
+
+
+        /** Destructor
+
+        Releases allocated birtual memory
+
+        @throw never
+        */
+        ~lock_free_memory_resource()
+        {
+            if ( replenisher_.joinable() )
+            {
+                {
+                    std::lock_guard< std::mutex > lock( replenisher_mutex_ );
+                    replenisher_stop_.store( true, std::memory_order_release );
+                }
+                replenisher_cv_.notify_one();
+                replenisher_.join();
+            }
+
+            // unmapping counts events in thread states, so it goes first
+            release_large_blocks();
+            trim_large_cache( std::numeric_limits< std::int64_t >::max() );
+            for ( auto chunk = large_blocks_.load( std::memory_order_acquire ); chunk; )
+            {
+                auto next = chunk->next_;
+                delete chunk;
+                chunk = next;
+            }
+
+            auto state = threads_.load( std::memory_order_acquire );
+            while ( state )
+            {
+                auto next = state->next_;
+
+                // lock the state to prevent its thread from exiting meanwhile
+                auto owner = wait_till_hazarded( [&]() noexcept {
+                    return state->owner_.fetch_or( hazard_, std::memory_order_acq_rel ); }
+                );
+
+                if ( owner )
+                {
+                    // the thread is still alive, let it release the state on exit
+                    state->owner_.store( 0, std::memory_order_release );
+                }
+                else
+                {
+                    // the thread is gone, nobody else refers the state
+                    delete state;
+                }
+
+                state = next;
+            }
+
+            if ( auto begin = slab_arena_.begin_.load( std::memory_order_acquire ) ) virtual_free( reinterpret_cast< void* >( begin ), slab_arena_size() );
+            if ( auto begin = heap_arena_.begin_.load( std::memory_order_acquire ) ) virtual_free( reinterpret_cast< void* >( begin ), heap_arena_size() );
+            delete[] cpu_caches_;
+
+            for ( auto pool : { pool_.load( std::memory_order_acquire ), reserve_.load( std::memory_order_acquire ) } )
+            {
+                while ( pool )
+                {
+                    auto& header = *reinterpret_cast< pool_block_header* >( pool );
+                    auto next = header.next_;
+                    auto size = header.size_.load( std::memory_order_relaxed );
+                    virtual_free( reinterpret_cast< void* >( pool ), size );
+                    pool = next;
+                }
+            }
+        }
+
+
+        /** Sums up internal event counters of all the threads
+
+        The counters are maintained only if Policy::statistics is set, otherwise all of them are zero. The snapshot is
+        not atomic, events counted while it is being taken could be included or not
+
+        @retval statistics snapshot
+        @throw never
+        */
+        statistics get_statistics() const noexcept
+        {
+            statistics result;
+            if constexpr ( Policy::statistics )
+            {
+                for ( std::size_t e = 0; e < event_count_; ++e ) result.events_[ e ] = counters_[ e ].load( std::memory_order_relaxed );
+                for ( auto state = threads_.load( std::memory_order_acquire ); state; state = state->next_ )
+                {
+                    for ( std::size_t e = 0; e < event_count_; ++e ) result.events_[ e ] += state->counters_[ e ].load( std::memory_order_relaxed );
+                }
+            }
+            return result;
+        }
+
+
+        /** Calls given visitor for every pool block
+
+        Safe to be called concurrently with allocations and deallocations
+
+        @param [in] visitor - callable object accepting size of pool block and size of its unallocated area
+        @throw whatever visitor throws
+        */
+        template < typename VisitorType >
+        void for_each_pool_block( VisitorType&& visitor ) const
+        {
+            for ( auto pool_block = pool_.load( std::memory_order_acquire ); pool_block; pool_block = reinterpret_cast< pool_block_header* >( pool_block )->next_ )
+            {
+                auto& header = *reinterpret_cast< pool_block_header* >( pool_block );
+                auto size = header.size_.load( std::memory_order_acquire );
+                auto unallocated = std::max< size_type >( pool_block + size - header.unallocated_.load( std::memory_order_acquire ), 0 );
+                visitor( static_cast< std::size_t >( size ), static_cast< std::size_t >( unallocated ) );
+            }
+        }
+
+
+        /** Takes snapshot of memory usage
+
+        Safe to be called concurrently with allocations and deallocations, garbage is walked the same way allocations
+        do, locking a released block at once. The snapshot is not atomic. Blocks cached in magazines or being
+        merged by coalesce() or trim() meanwhile are not counted as garbage, the ones cached by CPUs are counted
+        separately
+
+        @retval memory usage snapshot
+        @throw never
+        */
+        snapshot get_snapshot() noexcept
+        {
+            snapshot result;
+
+            // garbage goes first, so the pool walked after covers every released block counted
+            for ( auto bin = next_garbage_bin( 0 ); bin < garbage_bin_count_; bin = next_garbage_bin( bin + 1 ) )
+            {
+                // lock the bin head
+                auto current_garbage_block_ref = std::ref( garbage_[ bin ].head_ );
+                auto current_garbage_block = wait_till_hazarded( [&]() noexcept {
+                    return current_garbage_block_ref.get().fetch_or( hazard_, std::memory_order_acq_rel ); }, this
+                );
+
+                while ( current_garbage_block )
+                {
+                    auto size = static_cast< std::size_t >( reinterpret_cast< garbage_block_header* >( current_garbage_block )->size_ );
+                    ++result.garbage_block_count_;
+                    result.garbage_bytes_ += size;
+                    result.largest_garbage_block_ = std::max( result.largest_garbage_block_, size );
+
+                    // lock the next block and unlock current one
+                    auto next_garbage_block_ref = std::ref( reinterpret_cast< garbage_block_header* >( current_garbage_block )->next_ );
+                    auto next_garbage_block = wait_till_hazarded( [&]() noexcept {
+                        return next_garbage_block_ref.get().load( std::memory_order_acquire ); }, this
+                    );
+                    next_garbage_block_ref.get().store( next_garbage_block | hazard_, std::memory_order_relaxed );
+                    current_garbage_block_ref.get().store( current_garbage_block, std::memory_order_release );
+
+                    current_garbage_block_ref = next_garbage_block_ref;
+                    current_garbage_block = next_garbage_block;
+                }
+
+                // unlock the tail
+                current_garbage_block_ref.get().store( 0, std::memory_order_release );
+            }
+
+            for_each_pool_block( [ &result ]( std::size_t size, std::size_t unallocated ) noexcept {
+                ++result.pool_block_count_;
+                result.pool_bytes_ += size;
+                result.unallocated_bytes_ += unallocated;
+                result.largest_unallocated_ = std::max( result.largest_unallocated_, unallocated );
+            } );
+
+            result.large_block_count_ = static_cast< std::size_t >( large_count_.load( std::memory_order_relaxed ) );
+            result.large_block_bytes_ = static_cast< std::size_t >( large_bytes_.load( std::memory_order_relaxed ) );
+            result.reserve_bytes_ = static_cast< std::size_t >( reserve_bytes_.load( std::memory_order_relaxed ) );
+            if constexpr ( slab_class_count_ > 0 ) result.slab_bytes_ = static_cast< std::size_t >( std::min( slab_arena_.unallocated_.load( std::memory_order_relaxed ), slab_arena_size() ) );
+            if constexpr ( heap_class_count_ > 0 ) result.heap_bytes_ = static_cast< std::size_t >( std::min( heap_arena_.unallocated_.load( std::memory_order_relaxed ), heap_arena_size() ) );
+            result.large_cache_bytes_ = static_cast< std::size_t >( large_cache_bytes_.load( std::memory_order_relaxed ) );
+            for ( size_type cpu = 0; cpu < cpu_cache_count_; ++cpu )
+            {
+                auto& cache = cpu_caches_[ cpu ];
+                for ( size_type magazine = 0; magazine < magazine_count_; ++magazine )
+                {
+                    auto size = cache.magazine_sizes_[ magazine ].load( std::memory_order_relaxed );
+                    result.cpu_cache_bytes_ += static_cast< std::size_t >( size * ( magazine + 1 ) * granularity_ );
+                }
+                if ( auto bump = cache.bump_.load( std::memory_order_relaxed ) )
+                {
+                    auto end = cache.bump_end_.load( std::memory_order_relaxed ) & ~pointer_type( 1 );
+                    result.cpu_cache_bytes_ += static_cast< std::size_t >( std::max< pointer_type >( end - bump, 0 ) );
+                }
+            }
+            result.committed_bytes_ = result.pool_bytes_ + result.large_block_bytes_ + result.reserve_bytes_ + result.slab_bytes_ + result.heap_bytes_ + result.large_cache_bytes_;
+
+            if ( auto free_bytes = result.unallocated_bytes_ + result.garbage_bytes_ )
+            {
+                auto largest = std::max( result.largest_unallocated_, result.largest_garbage_block_ );
+                result.fragmentation_ = 1.0 - static_cast< double >( largest ) / static_cast< double >( free_bytes );
+            }
+
+            return result;
+        }
+
+
+        /** Merges physically adjacent released blocks
+
+        Detaches the garbage, sorts released blocks by address, merges adjacent ones and puts the result back. A
+        block adjacent to unallocated area of its pool block gets merged with the area. Blocks cached by thread
+        magazines are not affected. If another thread is maintaining the garbage the call returns immediately
+
+        @retval true if at least one block has been merged
+        @throw never
+        */
+        bool coalesce() noexcept
+        {
+            return maintain_garbage( true, 0 ).merged_;
+        }
+
+
+        /** Returns physical memory of released blocks and given back pool areas to OS
+
+        Virtual memory stays reserved, so the memory is available for following allocations. Adjacent released
+        blocks get merged before if Policy::coalescing is set. Blocks cached by CPU magazines and unused tails of
+        CPU chunks are moved to garbage first, while thread magazines are not affected. If another thread is
+        maintaining the garbage the call returns immediately. Cached large blocks get unmapped
+
+        @retval number of bytes returned to OS
+        @throw never
+        */
+        std::size_t trim() noexcept
+        {
+            flush_cpu_caches();
+            auto purged = maintain_garbage( Policy::coalescing, std::numeric_limits< std::int64_t >::max() ).purged_;
+            return static_cast< std::size_t >( purged + trim_large_cache( std::numeric_limits< std::int64_t >::max() ) );
+        }
+
+
+        /** Releases all the allocated memory at once, like std::pmr::monotonic_buffer_resource::release() does
+
+        Unallocated areas of pool blocks get rewound to the beginning of the blocks, garbage, slabs, thread
+        magazines, chunks and heaps get emptied, large blocks get returned to OS. Pool blocks stay mapped, so physical pages stay
+        hot for following allocations, except the blocks exceeding retained size that get returned to OS. Must not
+        be called concurrently with other calls, all the pieces allocated before become invalid
+
+        @param [in] retain - total size of pool blocks to be kept, the most recent blocks are kept first
+        @throw never
+        */
+        void release( std::size_t retain = std::numeric_limits< std::size_t >::max() ) noexcept
+        {
+            release_large_blocks();
+
+            // empty garbage
+            for ( auto& bin : garbage_ ) bin.head_.store( 0, std::memory_order_relaxed );
+            for ( auto& word : garbage_bitmap_ ) word.store( 0, std::memory_order_relaxed );
+
+            // empty magazines, the threads are not expected to use them meanwhile
+            if constexpr ( magazine_count_ > 0 )
+            {
+                for ( auto state = threads_.load( std::memory_order_acquire ); state; state = state->next_ )
+                {
+                    for ( size_type magazine = 0; magazine < magazine_count_; ++magazine )
+                    {
+                        state->magazines_[ magazine ] = state->magazine_tails_[ magazine ] = 0;
+                        state->magazine_sizes_[ magazine ] = 0;
+                    }
+                }
+            }
+
+            // drop thread chunks
+            if constexpr ( tlab_size_ > 0 )
+            {
+                for ( auto state = threads_.load( std::memory_order_acquire ); state; state = state->next_ ) state->tlab_ = state->tlab_end_ = 0;
+            }
+
+            // empty CPU magazines and drop CPU chunks
+            for ( size_type cpu = 0; cpu < cpu_cache_count_; ++cpu )
+            {
+                for ( auto& size : cpu_caches_[ cpu ].magazine_sizes_ ) size.store( 0, std::memory_order_relaxed );
+                cpu_caches_[ cpu ].bump_.store( 0, std::memory_order_relaxed );
+                cpu_caches_[ cpu ].bump_end_.store( 0, std::memory_order_relaxed );
+            }
+
+            // empty slabs, the runs stay faulted
+            if constexpr ( slab_class_count_ > 0 )
+            {
+                for ( auto& cls : slabs_ ) cls.head_.store( 0, std::memory_order_relaxed );
+                slab_arena_.unallocated_.store( 0, std::memory_order_relaxed );
+            }
+
+            // empty thread heaps, heap blocks stay faulted
+            if constexpr ( heap_class_count_ > 0 )
+            {
+                for ( auto state = threads_.load( std::memory_order_acquire ); state; state = state->next_ )
+                {
+                    state->heap_ = state->heap_limit_ = 0;
+                    for ( auto& head : state->heap_frees_ ) head = 0;
+                    for ( auto& count : state->heap_free_counts_ ) count = 0;
+                    if ( state->remote_frees_.load( std::memory_order_relaxed ) != sealed_ ) state->remote_frees_.store( 0, std::memory_order_relaxed );
+                }
+                heap_arena_.unallocated_.store( 0, std::memory_order_relaxed );
+            }
+
+            // rewind pool blocks fitting retained size and return the rest ones to OS
+            size_type retained = 0;
+            pointer_type head = 0, tail = 0;
+            for ( auto pool_block = pool_.load( std::memory_order_acquire ); pool_block; )
+            {
+                auto& header = *reinterpret_cast< pool_block_header* >( pool_block );
+                auto next = header.next_;
+                auto size = header.size_.load( std::memory_order_relaxed );
+                if ( static_cast< std::size_t >( retained + size ) <= retain )
+                {
+                    retained += size;
+                    auto unallocated = header.unallocated_.load( std::memory_order_relaxed );
+                    if ( header.dirty_.load( std::memory_order_relaxed ) < unallocated ) header.dirty_.store( unallocated, std::memory_order_relaxed );
+                    mark_used( header, unallocated );
+                    header.unallocated_.store( pool_block + pool_block_header_size_, std::memory_order_relaxed );
+                    header.next_ = 0;
+                    if ( tail ) reinterpret_cast< pool_block_header* >( tail )->next_ = pool_block; else head = pool_block;
+                    tail = pool_block;
+                }
+                else
+                {
+                    virtual_free( reinterpret_cast< void* >( pool_block ), size );
+                }
+                pool_block = next;
+            }
+            pool_.store( head, std::memory_order_release );
+        }
+
+
+        /** Captures position of pool bump pointer
+
+        @retval the position to be passed to rewind()
+        @throw never
+        */
+        mark checkpoint() const noexcept
+        {
+            mark result;
+            if ( ( result.pool_block_ = pool_.load( std::memory_order_acquire ) ) )
+            {
+                result.unallocated_ = reinterpret_cast< pool_block_header* >( result.pool_block_ )->unallocated_.load( std::memory_order_acquire );
+            }
+            if constexpr ( tlab_size_ > 0 )
+            {
+                if ( Policy::cpu_caches && cpu_caches_ )
+                {
+                    if ( auto cpu = current_cpu(); cpu >= 0 && cpu < cpu_cache_count_ )
+                    {
+                        result.tlab_ = cpu_caches_[ cpu ].bump_.load( std::memory_order_acquire );
+                        result.tlab_end_ = cpu_caches_[ cpu ].bump_end_.load( std::memory_order_acquire ) & ~pointer_type( 1 );
+                    }
+                }
+                else if ( auto state = find_local_state() )
+                {
+                    result.tlab_ = state->tlab_;
+                    result.tlab_end_ = state->tlab_end_;
+                }
+            }
+            return result;
+        }
+
+
+        /** Reclaims all the pieces carved from the pool after given checkpoint
+
+        Pool blocks grown after the checkpoint get emptied and stay mapped, the checkpoint block gets its bump pointer
+        moved back. Released blocks of the reclaimed area get dropped from garbage and magazines, so the call
+        costs a walk through the garbage if it is not empty. Pieces taken meanwhile from garbage, older pool blocks,
+        slabs, thread heaps or large blocks are not reclaimed and have to be deallocated as usual. The chunk of calling thread gets
+        its bump pointer moved back too, while pieces other threads carved from their chunks claimed before the
+        checkpoint are not reclaimed. Must not be called concurrently with other calls, all the pieces carved after
+        the checkpoint become invalid. The checkpoint stays valid till release(), so it could be used for rewinding
+        again
+
+        @param [in] m - position captured by checkpoint()
+        @throw never
+        */
+        void rewind( const mark& m ) noexcept
+        {
+            // empty pool blocks grown after the checkpoint and rewind the checkpoint one
+            auto head = pool_.load( std::memory_order_acquire );
+            for ( auto pool_block = head; pool_block; pool_block = reinterpret_cast< pool_block_header* >( pool_block )->next_ )
+            {
+                auto& header = *reinterpret_cast< pool_block_header* >( pool_block );
+                auto position = pool_block == m.pool_block_ ? m.unallocated_ : pool_block + pool_block_header_size_;
+                auto unallocated = header.unallocated_.load( std::memory_order_relaxed );
+                if ( unallocated > position )
+                {
+                    if ( header.dirty_.load( std::memory_order_relaxed ) < unallocated ) header.dirty_.store( unallocated, std::memory_order_relaxed );
+                    mark_used( header, unallocated );
+                    header.unallocated_.store( position, std::memory_order_release );
+                }
+                if ( pool_block == m.pool_block_ ) break;
+            }
+
+            // provides size of released block left after reclaimed area is cut off
+            auto clip = [ & ]( pointer_type block, size_type size ) noexcept {
+                for ( auto pool_block = head; pool_block; pool_block = reinterpret_cast< pool_block_header* >( pool_block )->next_ )
+                {
+                    auto& header = *reinterpret_cast< pool_block_header* >( pool_block );
+                    if ( block >= pool_block && block < pool_block + header.size_.load( std::memory_order_relaxed ) )
+                    {
+                        return std::max< size_type >( 0, std::min( block + size, header.unallocated_.load( std::memory_order_relaxed ) ) - block );
+                    }
+                    if ( pool_block == m.pool_block_ ) break;
+                }
+                return size;
+            };
+
+            // move back the chunk of calling thread and cut off reclaimed chunks of all the threads
+            if constexpr ( tlab_size_ > 0 )
+            {
+                if ( auto state = find_local_state(); state && m.tlab_end_ && state->tlab_end_ == m.tlab_end_ && state->tlab_ >= m.tlab_ )
+                {
+                    state->tlab_ = m.tlab_;
+                    state->tlab_fresh_ = false;
+                }
+                for ( auto state = threads_.load( std::memory_order_acquire ); state; state = state->next_ )
+                {
+                    if ( state->tlab_ < state->tlab_end_ ) state->tlab_end_ = state->tlab_ + clip( state->tlab_, state->tlab_end_ - state->tlab_ );
+                    if ( state->tlab_ == state->tlab_end_ ) state->tlab_ = state->tlab_end_ = 0;
+                }
+
+                // the same for CPU chunks, the lowest bit of chunk end tells the chunk is zero-filled
+                auto cpu = current_cpu();
+                for ( size_type i = 0; i < cpu_cache_count_; ++i )
+                {
+                    auto& cache = cpu_caches_[ i ];
+                    auto bump = cache.bump_.load( std::memory_order_relaxed );
+                    auto end = cache.bump_end_.load( std::memory_order_relaxed );
+                    auto fresh = end & 1;
+                    end &= ~pointer_type( 1 );
+                    if ( i == cpu && m.tlab_end_ && end == m.tlab_end_ && bump >= m.tlab_ )
+                    {
+                        bump = m.tlab_;
+                        fresh = 0;
+                    }
+                    if ( bump && bump < end ) end = bump + clip( bump, end - bump );
+                    if ( !bump || bump == end ) bump = end = fresh = 0;
+                    cache.bump_.store( bump, std::memory_order_relaxed );
+                    cache.bump_end_.store( end | fresh, std::memory_order_relaxed );
+                }
+            }
+
+            // drop reclaimed blocks from thread and CPU magazines, the threads are not expected to use them meanwhile
+            if constexpr ( magazine_count_ > 0 )
+            {
+                auto clip_magazines = [&]( thread_state& state ) noexcept
+                {
+                    for ( size_type magazine = 0; magazine < magazine_count_; ++magazine )
+                    {
+                        auto block = state.magazines_[ magazine ];
+                        state.magazines_[ magazine ] = state.magazine_tails_[ magazine ] = 0;
+                        state.magazine_sizes_[ magazine ] = 0;
+                        for ( ; block; block = next_garbage_block_ref( block ).load( std::memory_order_relaxed ) )
+                        {
+                            if ( !clip( block, ( magazine + 1 ) * granularity_ ) ) continue;
+                            if ( state.magazine_tails_[ magazine ] )
+                            {
+                                next_garbage_block_ref( state.magazine_tails_[ magazine ] ).store( block, std::memory_order_relaxed );
+                            }
+                            else
+                            {
+                                state.magazines_[ magazine ] = block;
+                            }
+                            state.magazine_tails_[ magazine ] = block;
+                            ++state.magazine_sizes_[ magazine ];
+                        }
+                        if ( state.magazine_tails_[ magazine ] ) next_garbage_block_ref( state.magazine_tails_[ magazine ] ).store( 0, std::memory_order_relaxed );
+                    }
+                };
+                for ( auto state = threads_.load( std::memory_order_acquire ); state; state = state->next_ ) clip_magazines( *state );
+                for ( size_type cpu = 0; cpu < cpu_cache_count_; ++cpu )
+                {
+                    auto& cache = cpu_caches_[ cpu ];
+                    for ( size_type magazine = 0; magazine < magazine_count_; ++magazine )
+                    {
+                        auto& blocks = cache.magazines_[ magazine ];
+                        auto size = cache.magazine_sizes_[ magazine ].load( std::memory_order_relaxed );
+                        size_type kept = 0;
+                        for ( size_type i = 0; i < size; ++i )
+                        {
+                            if ( clip( blocks[ i ], ( magazine + 1 ) * granularity_ ) ) blocks[ kept++ ] = blocks[ i ];
+                        }
+                        cache.magazine_sizes_[ magazine ].store( kept, std::memory_order_relaxed );
+                    }
+                }
+            }
+
+            // drop reclaimed blocks from garbage, cut off reclaimed tails of blocks merged across the checkpoint
+            if ( next_garbage_bin( 0 ) < garbage_bin_count_ )
+            {
+                while ( maintenance_.exchange( true, std::memory_order_acquire ) ) std::this_thread::yield();
+                for ( auto block = detach_garbage(); block; )
+                {
+                    auto& header = *reinterpret_cast< garbage_block_header* >( block );
+                    auto next = header.next_.load( std::memory_order_relaxed );
+                    if ( ( header.size_ = clip( block, header.size_ ) ) ) put_to_garbage( block );
+                    block = next;
+                }
+                maintenance_.store( false, std::memory_order_release );
+            }
+        }
+
+
+        /** Allocates zero-filled piece
+
+        Clears the piece only if it has been used before, never allocated pool area and freshly mapped large block are
+        taken as is since they are zero-filled by OS
+
+        @param [in] bytes - requested size
+        @param [in] alignment - requested alignment
+        @retval pointer to zero-filled piece
+        @throw std::invalid_argument if size or alignment is invalid, std::bad_alloc if memory is low
+        */
+        void* allocate_zeroed( std::size_t bytes, std::size_t alignment = alignof( std::max_align_t ) )
+        {
+            auto fresh = false;
+            auto p = allocate_piece( bytes, alignment, &fresh );
+            if ( !fresh ) std::memset( p, 0, bytes );
+            return p;
+        }
+
+
+        /** Tries to resize allocated piece in place
+
+        Succeeds if the piece is a pool piece ending at unallocated area of its pool block that is large enough, a
+        large block that could be remapped in place, or a slab piece staying within its size class. Shrinking
+        usually succeeds. The piece keeps its kind, so a pool piece does not turn into large block and vice versa
+
+        @param [in] p - allocated piece
+        @param [in] old_bytes - size passed to allocate()
+        @param [in] new_bytes - new size
+        @param [in] alignment - alignment passed to allocate()
+        @retval true if the piece has been resized, further it has to be deallocated with new size
+        @throw never
+        */
+        bool try_expand( void* p, std::size_t old_bytes, std::size_t new_bytes, std::size_t alignment = alignof( std::max_align_t ) ) noexcept
+        {
+            return p && new_bytes && resize( p, old_bytes, new_bytes, alignment, false ) == p;
+        }
+
+
+        /** Resizes allocated piece
+
+        Tries to resize the piece in place, large block could be remapped to another address without copying. If
+        nothing helps new piece gets allocated, the content gets copied and old piece gets deallocated
+
+        @param [in] p - allocated piece or nullptr
+        @param [in] old_bytes - size passed to allocate()
+        @param [in] new_bytes - new size
+        @param [in] alignment - alignment passed to allocate()
+        @retval pointer to resized piece
+        @throw std::invalid_argument if new size or alignment is invalid, std::bad_alloc if memory is low, the piece
+               stays intact then
+        */
+        void* reallocate( void* p, std::size_t old_bytes, std::size_t new_bytes, std::size_t alignment = alignof( std::max_align_t ) )
+        {
+            check_request( new_bytes, alignment );
+            if ( !p ) return allocate( new_bytes, alignment );
+            if ( auto resized = resize( p, old_bytes, new_bytes, alignment, true ) ) return resized;
+
+            auto moved = allocate( new_bytes, alignment );
+            std::memcpy( moved, p, std::min( old_bytes, new_bytes ) );
+            deallocate( p, old_bytes, alignment );
+            return moved;
+        }
+
+
+        /** Allocates a number of pieces of the same size and alignment
+
+        Pieces that could be allocated on pool get carved from spans taken from the garbage or the pool by a single
+        operation each, a span fits one pool block at most. Slab and large pieces are allocated one by one
+
+        @param [in] n - number of pieces
+        @param [in] bytes - size of each piece
+        @param [in] alignment - alignment of each piece
+        @param [out] out - array receiving n pointers to the pieces
+        @throw std::invalid_argument if size or alignment is invalid, std::bad_alloc if memory is low, no pieces are
+               left allocated then
+        */
+        void allocate_bulk( std::size_t n, std::size_t bytes, std::size_t alignment, void** out )
+        {
+            check_request( bytes, alignment );
+
+            std::size_t allocated = 0;
+            try
+            {
+                auto aligned_offset = ceil( piece_internal_fields_size_, alignment );
+                auto stride = ceil( aligned_offset + bytes + piece_trailer_size_, granularity_ );
+                bool slab = slab_class_count_ > 0 && bytes <= Policy::slab_max_size && alignment <= cache_line_size;
+                bool heap = stride / granularity_ <= heap_class_count_;
+
+                // pieces of varying block size are allocated one by one
+                if ( slab || heap || static_cast< size_type >( alignment ) > granularity_ || required_pool_block_size( bytes, alignment ) > pool_block_size() )
+                {
+                    for ( ; allocated < n; ++allocated ) out[ allocated ] = do_allocate( bytes, alignment );
+                    return;
+                }
+
+                while ( allocated < n )
+                {
+                    auto count = std::min( static_cast< size_type >( n - allocated ), pool_block_capacity() / stride );
+
+                    // take a span that exactly fits the pieces
+                    auto span_bytes = static_cast< std::size_t >( count * stride - piece_internal_fields_size_ - piece_trailer_size_ );
+                    auto span = allocate_on_garbage( span_bytes, 1 );
+                    if ( span ) notify( event::garbage_allocation ); else span = allocate_on_pool( span_bytes, 1 );
+
+                    // carve the pieces out of the span
+                    for ( auto block = reinterpret_cast< pointer_type >( span ) - piece_internal_fields_size_; count--; block += stride )
+                    {
+                        auto aligned_area = block + aligned_offset;
+                        if constexpr ( !Policy::trusted_size )
+                        {
+                            *reinterpret_cast< size_type* >( block ) = stride;
+                            get_block_header_ptr_ref( aligned_area ) = block;
+                        }
+                        set_piece_trailer( block + stride );
+                        out[ allocated++ ] = reinterpret_cast< void* >( aligned_area );
+                    }
+                }
+            }
+            catch ( ... )
+            {
+                deallocate_bulk( out, allocated, bytes, alignment );
+                throw;
+            }
+        }
+
+
+        /** Deallocates a number of pieces of the same size and alignment
+
+        Released pieces are linked into chains by garbage bin, a chain gets prepended to its bin by a single CAS.
+        Thread magazines are bypassed
+
+        @param [in] pieces - array of n pointers to the pieces, null pointers are skipped
+        @param [in] n - number of pieces
+        @param [in] bytes - size of each piece
+        @param [in] alignment - alignment of each piece
+        @throw never
+        */
+        void deallocate_bulk( void* const* pieces, std::size_t n, std::size_t bytes, std::size_t alignment ) noexcept
+        {
+            auto stamp = release_stamp();
+            size_type bin = garbage_bin_count_;
+            pointer_type first = 0, last = 0;
+
+            for ( std::size_t i = 0; i < n; ++i )
+            {
+                auto p = pieces[ i ];
+                if ( !p ) continue;
+
+                if constexpr ( slab_class_count_ > 0 )
+                {
+                    if ( is_slab_piece( p ) )
+                    {
+                        deallocate_on_slab( p );
+                        continue;
+                    }
+                }
+
+                auto [ block, block_size ] = get_piece_block( p, bytes, alignment );
+                if ( heap_class_count_ > 0 && is_heap_piece( p ) )
+                {
+                    deallocate_on_heap( block, block_size );
+                    continue;
+                }
+                if ( block_size > pool_block_capacity() )
+                {
+                    deallocate_large_block( block, block_size );
+                    continue;
+                }
+                if constexpr ( Policy::trusted_size ) reinterpret_cast< garbage_block_header* >( block )->size_ = block_size;
+                reinterpret_cast< garbage_block_header* >( block )->stamp_ = stamp;
+
+                // the pieces are usually of the same bin, flush the chain if not
+                auto block_bin = std::min( garbage_bin_index( block_size ), garbage_bin_count_ - 1 );
+                if ( first && block_bin != bin )
+                {
+                    put_to_garbage( bin, first, last );
+                    first = 0;
+                }
+
+                if ( first ) next_garbage_block_ref( last ).store( block, std::memory_order_relaxed ); else first = block;
+                last = block;
+                bin = block_bin;
+            }
+
+            if ( first ) put_to_garbage( bin, first, last );
+            if constexpr ( Policy::purge_decay > 0 ) purge_on_decay( stamp );
+        }
+    };
+
+
+    /** Allocates at least n objects by given polymorphic allocator
+
+    If the allocator uses a resource implementing at_least_capable (e.g. lock_free_memory_resource of any policy),
+    the slack the piece got rounded up with is reported as additional objects, otherwise exactly n objects get
+    allocated. The result could be deallocated by the allocator with any number of objects between n and the
+    reported one
+
+    @tparam T - object type
+    @param [in] allocator - polymorphic allocator
+    @param [in] n - requested number of objects
+    @retval pointer to the objects and their number
+    @throw std::bad_array_new_length if the size exceeds limits, std::bad_alloc if memory is low
+    */
+    template < typename T >
+    std::pair< T*, std::size_t > allocate_at_least( std::pmr::polymorphic_allocator< T >& allocator, std::size_t n )
+    {
+        if ( auto resource = dynamic_cast< at_least_capable* >( allocator.resource() ) )
+        {
+            if ( n > std::numeric_limits< std::size_t >::max() / sizeof( T ) ) throw std::bad_array_new_length();
+            auto result = resource->allocate_at_least( n * sizeof( T ), alignof( T ) );
+            return { static_cast< T* >( result.ptr_ ), result.count_ / sizeof( T ) };
+        }
+        return { allocator.allocate( n ), n };
+    }
+}
+
+#ifdef LFMR_RSEQ_CRITICAL_SECTIONS
+#   undef LFMR_RSEQ_SIG
+#   undef LFMR_RSEQ_BEGIN
+#   undef LFMR_RSEQ_END
+#   undef LFMR_RSEQ_POP
+#   undef LFMR_RSEQ_PUSH
+#   undef LFMR_RSEQ_BUMP
+#   undef LFMR_RSEQ_SWAP_CHUNK
+#endif
 
 #endif
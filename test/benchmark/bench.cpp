@@ -0,0 +1,256 @@
+// MIT License
+//
+// Copyright( c ) 2021 Alexey Pavlyutkin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+//
+// Microbenchmarks of allocation paths of lock_free_memory_resource in isolation, and comparison of the resource
+// with standard memory resources
+//
+
+
+#include <benchmark/benchmark.h>
+#include "accessor.h"
+#include "policy.h"
+#include <lfmr/lock_free_memory_resource.h>
+#include <memory_resource>
+#include <optional>
+#include <vector>
+#include <cstdint>
+
+
+namespace bits
+{
+    namespace bench
+    {
+        using namespace ut;
+
+        // number of pieces allocated before the state gets reset
+        static constexpr std::size_t batch_size = 1024;
+
+        // sizes and alignments of pieces to be allocated on pool
+        static void small_pieces( benchmark::internal::Benchmark* b )
+        {
+            b->ArgNames( { "size", "alignment" } )->ArgsProduct( { { 8, 64, 512, 4096 }, { 8, 64 } } );
+        }
+
+        // sizes of pieces that exceed pool block
+        static void large_pieces( benchmark::internal::Benchmark* b )
+        {
+            b->ArgNames( { "size", "alignment" } )->ArgsProduct( { { 1 << 17, 1 << 20, 1 << 23 }, { 8 } } );
+        }
+
+        //-----------------------------------------------------------------------------------------------------------------------------------------------------
+
+        template < typename Policy >
+        void allocate_on_pool( benchmark::State& state )
+        {
+            using accessor_type = accessor< lock_free_memory_resource< Policy > >;
+            auto bytes = static_cast< std::size_t >( state.range( 0 ) );
+            auto alignment = static_cast< std::size_t >( state.range( 1 ) );
+
+            std::optional< lock_free_memory_resource< Policy > > mr;
+            mr.emplace();
+            std::size_t allocated = 0;
+            for ( auto _ : state )
+            {
+                benchmark::DoNotOptimize( accessor_type::allocate_on_pool( *mr, bytes, alignment ) );
+
+                // start over on the fresh resource
+                if ( ++allocated == batch_size )
+                {
+                    state.PauseTiming();
+                    mr.reset();
+                    mr.emplace();
+                    allocated = 0;
+                    state.ResumeTiming();
+                }
+            }
+            state.SetItemsProcessed( state.iterations() );
+        }
+
+        //-----------------------------------------------------------------------------------------------------------------------------------------------------
+
+        template < typename Policy >
+        void allocate_on_garbage( benchmark::State& state )
+        {
+            using accessor_type = accessor< lock_free_memory_resource< Policy > >;
+            auto bytes = static_cast< std::size_t >( state.range( 0 ) );
+            auto alignment = static_cast< std::size_t >( state.range( 1 ) );
+
+            lock_free_memory_resource< Policy > mr;
+            std::vector< void* > pieces( batch_size );
+            for ( auto& p : pieces ) p = mr.allocate( bytes, alignment );
+            for ( auto p : pieces ) mr.deallocate( p, bytes, alignment );
+
+            std::size_t allocated = 0;
+            for ( auto _ : state )
+            {
+                auto p = accessor_type::allocate_on_garbage( mr, bytes, alignment );
+                if ( !p )
+                {
+                    state.SkipWithError( "garbage is exhausted" );
+                    break;
+                }
+                pieces[ allocated ] = p;
+
+                // give the pieces back to garbage
+                if ( ++allocated == batch_size )
+                {
+                    state.PauseTiming();
+                    for ( auto p : pieces ) mr.deallocate( p, bytes, alignment );
+                    allocated = 0;
+                    state.ResumeTiming();
+                }
+            }
+            for ( std::size_t i = 0; i < allocated; ++i ) mr.deallocate( pieces[ i ], bytes, alignment );
+            state.SetItemsProcessed( state.iterations() );
+        }
+
+        //-----------------------------------------------------------------------------------------------------------------------------------------------------
+
+        template < typename Policy >
+        void allocate_large_block( benchmark::State& state )
+        {
+            using accessor_type = accessor< lock_free_memory_resource< Policy > >;
+            auto bytes = static_cast< std::size_t >( state.range( 0 ) );
+            auto alignment = static_cast< std::size_t >( state.range( 1 ) );
+
+            lock_free_memory_resource< Policy > mr;
+            std::vector< void* > pieces( batch_size / 16 );
+            std::size_t allocated = 0;
+            for ( auto _ : state )
+            {
+                pieces[ allocated ] = accessor_type::allocate_large_block( mr, bytes, alignment );
+
+                // release the blocks
+                if ( ++allocated == pieces.size() )
+                {
+                    state.PauseTiming();
+                    for ( auto p : pieces ) mr.deallocate( p, bytes, alignment );
+                    allocated = 0;
+                    state.ResumeTiming();
+                }
+            }
+            for ( std::size_t i = 0; i < allocated; ++i ) mr.deallocate( pieces[ i ], bytes, alignment );
+            state.SetItemsProcessed( state.iterations() );
+        }
+
+        //-----------------------------------------------------------------------------------------------------------------------------------------------------
+
+        template < typename Policy >
+        void do_deallocate( benchmark::State& state )
+        {
+            using accessor_type = accessor< lock_free_memory_resource< Policy > >;
+            auto bytes = static_cast< std::size_t >( state.range( 0 ) );
+            auto alignment = static_cast< std::size_t >( state.range( 1 ) );
+
+            lock_free_memory_resource< Policy > mr;
+            std::vector< void* > pieces( batch_size );
+            std::size_t deallocated = batch_size;
+            for ( auto _ : state )
+            {
+                // get the next batch of pieces to be released
+                if ( deallocated == batch_size )
+                {
+                    state.PauseTiming();
+                    for ( auto& p : pieces ) p = mr.allocate( bytes, alignment );
+                    deallocated = 0;
+                    state.ResumeTiming();
+                }
+
+                accessor_type::do_deallocate( mr, pieces[ deallocated++ ], bytes, alignment );
+            }
+            for ( ; deallocated < batch_size; ++deallocated ) mr.deallocate( pieces[ deallocated ], bytes, alignment );
+            state.SetItemsProcessed( state.iterations() );
+        }
+
+        //-----------------------------------------------------------------------------------------------------------------------------------------------------
+
+        // provides memory resource of given type to allocate_deallocate benchmark
+        template < typename Resource >
+        struct resource_holder
+        {
+            Resource resource_;
+            std::pmr::memory_resource& get() noexcept { return resource_; }
+            void release() noexcept {}
+        };
+
+        template <>
+        struct resource_holder< std::pmr::monotonic_buffer_resource >
+        {
+            std::pmr::monotonic_buffer_resource resource_;
+            std::pmr::memory_resource& get() noexcept { return resource_; }
+            void release() noexcept { resource_.release(); }
+        };
+
+        struct new_delete_resource {};
+
+        template <>
+        struct resource_holder< new_delete_resource >
+        {
+            std::pmr::memory_resource& get() noexcept { return *std::pmr::new_delete_resource(); }
+            void release() noexcept {}
+        };
+
+        template < typename Resource >
+        void allocate_deallocate( benchmark::State& state )
+        {
+            auto bytes = static_cast< std::size_t >( state.range( 0 ) );
+            auto alignment = static_cast< std::size_t >( state.range( 1 ) );
+
+            resource_holder< Resource > holder;
+            auto& mr = holder.get();
+            std::vector< void* > pieces( 64 );
+            for ( auto _ : state )
+            {
+                for ( auto& p : pieces ) p = mr.allocate( bytes, alignment );
+                for ( auto p : pieces ) mr.deallocate( p, bytes, alignment );
+                holder.release();
+            }
+            state.SetItemsProcessed( state.iterations() * pieces.size() );
+        }
+
+        //-----------------------------------------------------------------------------------------------------------------------------------------------------
+
+        BENCHMARK_TEMPLATE( allocate_on_pool, default_policy )->Apply( small_pieces );
+        BENCHMARK_TEMPLATE( allocate_on_pool, set_granularity< default_policy, 0x100 > )->Apply( small_pieces );
+        BENCHMARK_TEMPLATE( allocate_on_pool, set_garbage_search_depth< default_policy, 4 > )->Apply( small_pieces );
+
+        BENCHMARK_TEMPLATE( allocate_on_garbage, default_policy )->Apply( small_pieces );
+        BENCHMARK_TEMPLATE( allocate_on_garbage, set_granularity< default_policy, 0x100 > )->Apply( small_pieces );
+        BENCHMARK_TEMPLATE( allocate_on_garbage, set_garbage_search_depth< default_policy, 4 > )->Apply( small_pieces );
+
+        BENCHMARK_TEMPLATE( allocate_large_block, default_policy )->Apply( large_pieces );
+
+        BENCHMARK_TEMPLATE( do_deallocate, default_policy )->Apply( small_pieces );
+        BENCHMARK_TEMPLATE( do_deallocate, set_granularity< default_policy, 0x100 > )->Apply( small_pieces );
+        BENCHMARK_TEMPLATE( do_deallocate, set_garbage_search_depth< default_policy, 4 > )->Apply( small_pieces );
+
+        BENCHMARK_TEMPLATE( allocate_deallocate, lock_free_memory_resource< default_policy > )->Apply( small_pieces );
+        BENCHMARK_TEMPLATE( allocate_deallocate, lock_free_memory_resource< set_granularity< default_policy, 0x100 > > )->Apply( small_pieces );
+        BENCHMARK_TEMPLATE( allocate_deallocate, lock_free_memory_resource< set_garbage_search_depth< default_policy, 4 > > )->Apply( small_pieces );
+        BENCHMARK_TEMPLATE( allocate_deallocate, new_delete_resource )->Apply( small_pieces );
+        BENCHMARK_TEMPLATE( allocate_deallocate, std::pmr::unsynchronized_pool_resource )->Apply( small_pieces );
+        BENCHMARK_TEMPLATE( allocate_deallocate, std::pmr::synchronized_pool_resource )->Apply( small_pieces );
+        BENCHMARK_TEMPLATE( allocate_deallocate, std::pmr::monotonic_buffer_resource )->Apply( small_pieces );
+    }
+}
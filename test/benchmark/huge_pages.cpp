@@ -0,0 +1,176 @@
+// MIT License
+//
+// Copyright( c ) 2021 Alexey Pavlyutkin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+//
+// Compares dTLB misses of random memory access over pieces allocated with and without huge pages
+//
+// usage: huge_pages_benchmark [heap size in MB] [number of steps in millions]
+//
+
+
+#include <lfmr/lock_free_memory_resource.h>
+#include <vector>
+#include <random>
+#include <numeric>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#ifdef __linux__
+#   include <linux/perf_event.h>
+#   include <sys/ioctl.h>
+#   include <sys/syscall.h>
+#   include <unistd.h>
+#endif
+
+
+namespace
+{
+    template < bool HugePages >
+    struct benchmark_policy : public bits::default_policy
+    {
+        static constexpr std::size_t block_size = 1 << 21;
+        static constexpr bool huge_pages = HugePages;
+    };
+
+
+    // piece of the chain to be chased
+    struct alignas( 64 ) node
+    {
+        node* next_;
+        char payload_[ 256 - sizeof( node* ) ];
+    };
+
+
+    // counts dTLB read misses of current thread if the system allows that
+    class tlb_miss_counter
+    {
+#ifdef __linux__
+        int fd_ = -1;
+#endif
+
+    public:
+
+        tlb_miss_counter() noexcept
+        {
+#ifdef __linux__
+            perf_event_attr attr;
+            std::memset( &attr, 0, sizeof( attr ) );
+            attr.size = sizeof( attr );
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = PERF_COUNT_HW_CACHE_DTLB | ( PERF_COUNT_HW_CACHE_OP_READ << 8 ) | ( PERF_COUNT_HW_CACHE_RESULT_MISS << 16 );
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            fd_ = static_cast< int >( ::syscall( __NR_perf_event_open, &attr, 0, -1, -1, 0 ) );
+#endif
+        }
+
+        ~tlb_miss_counter()
+        {
+#ifdef __linux__
+            if ( fd_ >= 0 ) ::close( fd_ );
+#endif
+        }
+
+        bool available() const noexcept
+        {
+#ifdef __linux__
+            return fd_ >= 0;
+#else
+            return false;
+#endif
+        }
+
+        void start() noexcept
+        {
+#ifdef __linux__
+            if ( fd_ < 0 ) return;
+            ::ioctl( fd_, PERF_EVENT_IOC_RESET, 0 );
+            ::ioctl( fd_, PERF_EVENT_IOC_ENABLE, 0 );
+#endif
+        }
+
+        std::uint64_t stop() noexcept
+        {
+            std::uint64_t value = 0;
+#ifdef __linux__
+            if ( fd_ < 0 ) return 0;
+            ::ioctl( fd_, PERF_EVENT_IOC_DISABLE, 0 );
+            if ( ::read( fd_, &value, sizeof( value ) ) != sizeof( value ) ) value = 0;
+#endif
+            return value;
+        }
+    };
+
+
+    template < bool HugePages >
+    void run( std::size_t heap_size, std::size_t steps )
+    {
+        bits::lock_free_memory_resource< benchmark_policy< HugePages > > mr;
+
+        // spread nodes over the heap and link them into a single random cycle
+        std::vector< node* > nodes( heap_size / sizeof( node ) );
+        for ( auto& n : nodes ) n = static_cast< node* >( mr.allocate( sizeof( node ), alignof( node ) ) );
+
+        std::vector< std::size_t > order( nodes.size() );
+        std::iota( order.begin(), order.end(), 0 );
+        std::shuffle( order.begin(), order.end(), std::mt19937_64( 42 ) );
+        for ( std::size_t i = 0; i < order.size(); ++i ) nodes[ order[ i ] ]->next_ = nodes[ order[ ( i + 1 ) % order.size() ] ];
+
+        // chase the chain
+        tlb_miss_counter counter;
+        node* volatile p = nodes.front();
+        auto start = std::chrono::steady_clock::now();
+        counter.start();
+        for ( std::size_t i = 0; i < steps; ++i ) p = p->next_;
+        auto misses = counter.stop();
+        auto elapsed = std::chrono::duration_cast< std::chrono::nanoseconds >( std::chrono::steady_clock::now() - start ).count();
+
+        std::printf( "%-12s %12.2f ns/step", HugePages ? "huge pages" : "plain pages", static_cast< double >( elapsed ) / steps );
+        if ( counter.available() )
+        {
+            std::printf( " %14llu dTLB misses %8.4f per step", static_cast< unsigned long long >( misses ), static_cast< double >( misses ) / steps );
+        }
+        else
+        {
+            std::printf( "     dTLB misses not available" );
+        }
+        std::printf( "\n" );
+
+        for ( auto n : nodes ) mr.deallocate( n, sizeof( node ), alignof( node ) );
+    }
+}
+
+
+int main( int argc, char** argv )
+{
+    std::size_t heap_size = ( argc > 1 ? std::strtoull( argv[ 1 ], nullptr, 10 ) : 256 ) << 20;
+    std::size_t steps = ( argc > 2 ? std::strtoull( argv[ 2 ], nullptr, 10 ) : 16 ) * 1000000;
+
+    run< false >( heap_size, steps );
+    run< true >( heap_size, steps );
+
+    return 0;
+}
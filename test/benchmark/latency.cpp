@@ -0,0 +1,253 @@
+// MIT License
+//
+// Copyright( c ) 2021 Alexey Pavlyutkin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+//
+// Measures latency of every allocation and deallocation with TSC based clock, and reports percentiles broken down
+// by path served the request
+//
+// usage: latency_benchmark [number of threads] [number of operations per thread] [large block rate per mille]
+//
+
+
+#include <lfmr/lock_free_memory_resource.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+#if defined( _MSC_VER )
+#   include <intrin.h>
+#elif defined( __x86_64__ ) || defined( __i386__ )
+#   include <x86intrin.h>
+#endif
+
+
+namespace
+{
+    using bits::event;
+
+    // reads time stamp counter, falls back to steady clock on other platforms
+    inline std::uint64_t ticks() noexcept
+    {
+#if defined( _MSC_VER ) || defined( __x86_64__ ) || defined( __i386__ )
+        _mm_lfence();
+        auto value = __rdtsc();
+        _mm_lfence();
+        return value;
+#else
+        return static_cast< std::uint64_t >( std::chrono::steady_clock::now().time_since_epoch().count() );
+#endif
+    }
+
+    // number of ticks per nanosecond
+    double calibrate() noexcept
+    {
+        auto start_time = std::chrono::steady_clock::now();
+        auto start = ticks();
+        std::this_thread::sleep_for( std::chrono::milliseconds( 100 ) );
+        auto stop = ticks();
+        auto elapsed = std::chrono::duration_cast< std::chrono::nanoseconds >( std::chrono::steady_clock::now() - start_time ).count();
+        return static_cast< double >( stop - start ) / static_cast< double >( elapsed );
+    }
+
+
+    // log-linear histogram in spirit of HdrHistogram: values are kept with 2^-6 relative precision
+    class histogram
+    {
+        static constexpr unsigned sub_bucket_bits_ = 7;
+        static constexpr std::size_t sub_bucket_count_ = std::size_t( 1 ) << sub_bucket_bits_;
+        static constexpr std::size_t bucket_count_ = ( 64 - sub_bucket_bits_ + 2 ) * ( sub_bucket_count_ / 2 );
+
+        std::array< std::uint64_t, bucket_count_ > counts_ = {};
+        std::uint64_t total_ = 0;
+        std::uint64_t max_ = 0;
+
+        static std::size_t index( std::uint64_t value ) noexcept
+        {
+            if ( value < sub_bucket_count_ ) return static_cast< std::size_t >( value );
+            unsigned exponent = 0;
+            for ( auto v = value >> sub_bucket_bits_; v; v >>= 1, ++exponent );
+            return exponent * ( sub_bucket_count_ / 2 ) + static_cast< std::size_t >( value >> exponent );
+        }
+
+        // upper bound of values kept by given bucket
+        static std::uint64_t value( std::size_t index ) noexcept
+        {
+            if ( index < sub_bucket_count_ ) return index;
+            auto exponent = index / ( sub_bucket_count_ / 2 ) - 1;
+            auto mantissa = index - exponent * ( sub_bucket_count_ / 2 );
+            return ( ( mantissa + 1 ) << exponent ) - 1;
+        }
+
+    public:
+
+        void record( std::uint64_t value ) noexcept
+        {
+            ++counts_[ index( value ) ];
+            ++total_;
+            max_ = std::max( max_, value );
+        }
+
+        histogram& operator+=( const histogram& other ) noexcept
+        {
+            for ( std::size_t i = 0; i < bucket_count_; ++i ) counts_[ i ] += other.counts_[ i ];
+            total_ += other.total_;
+            max_ = std::max( max_, other.max_ );
+            return *this;
+        }
+
+        std::uint64_t total() const noexcept { return total_; }
+        std::uint64_t max() const noexcept { return max_; }
+
+        std::uint64_t percentile( double p ) const noexcept
+        {
+            auto rank = static_cast< std::uint64_t >( p / 100.0 * static_cast< double >( total_ ) );
+            std::uint64_t seen = 0;
+            for ( std::size_t i = 0; i < bucket_count_; ++i )
+            {
+                seen += counts_[ i ];
+                if ( seen > rank ) return std::min( value( i ), max_ );
+            }
+            return max_;
+        }
+    };
+
+
+    // paths which could serve a request
+    enum path : std::size_t { magazine, garbage, pool_bump, pool_grow, reserve, large_block, release, release_large_block, path_count };
+    const char* path_names[ path_count ] = { "magazine", "garbage", "pool bump", "pool grow", "reserve", "large block", "release", "release large" };
+
+    // events reported while current request is served
+    thread_local unsigned observed_events = 0;
+
+    template < typename Base >
+    struct latency_policy : public Base
+    {
+        static void on_event( event e ) noexcept { observed_events |= 1u << static_cast< unsigned >( e ); }
+    };
+
+    inline bool observed( event e ) noexcept { return observed_events & ( 1u << static_cast< unsigned >( e ) ); }
+
+    path allocation_path() noexcept
+    {
+        if ( observed( event::large_block_map ) ) return large_block;
+        if ( observed( event::pool_grow ) ) return pool_grow;
+        if ( observed( event::reserve_take ) ) return reserve;
+        if ( observed( event::pool_allocation ) ) return pool_bump;
+        if ( observed( event::magazine_allocation ) ) return magazine;
+        return garbage;
+    }
+
+
+    template < typename Policy >
+    void run( const char* name, std::size_t thread_count, std::size_t operations, std::size_t large_rate, double ticks_per_ns )
+    {
+        bits::lock_free_memory_resource< latency_policy< Policy > > mr;
+        std::vector< std::array< histogram, path_count > > histograms( thread_count );
+        std::atomic< std::size_t > ready = 0;
+
+        auto worker = [ & ]( std::size_t self ) {
+            std::mt19937 random( static_cast< unsigned >( self ) );
+            std::uniform_int_distribution< std::size_t > slots( 0, 1023 ), exponents( 4, 12 ), per_mille( 0, 999 );
+            std::vector< std::pair< void*, std::size_t > > working_set( 1024, { nullptr, 0 } );
+            auto& h = histograms[ self ];
+
+            ready.fetch_add( 1 );
+            while ( ready.load() < thread_count ) std::this_thread::yield();
+
+            for ( std::size_t i = 0; i < operations; ++i )
+            {
+                auto& [ p, sz ] = working_set[ slots( random ) ];
+                observed_events = 0;
+                if ( p )
+                {
+                    auto start = ticks();
+                    mr.deallocate( p, sz );
+                    auto stop = ticks();
+                    h[ observed( event::large_block_unmap ) ? release_large_block : release ].record( stop - start );
+                    p = nullptr;
+                }
+                else
+                {
+                    sz = per_mille( random ) < large_rate ? Policy::block_size * 2 : random() % ( std::size_t( 1 ) << exponents( random ) ) + 1;
+                    auto start = ticks();
+                    p = mr.allocate( sz );
+                    auto stop = ticks();
+                    h[ allocation_path() ].record( stop - start );
+                }
+            }
+
+            for ( auto [ p, sz ] : working_set ) if ( p ) mr.deallocate( p, sz );
+        };
+
+        std::vector< std::thread > threads;
+        for ( std::size_t t = 0; t < thread_count; ++t ) threads.emplace_back( worker, t );
+        for ( auto& thread : threads ) thread.join();
+
+        std::printf( "%s, %zu thread(s)\n", name, thread_count );
+        std::printf( "  %-14s %12s %10s %10s %10s %12s\n", "path", "count", "p50, ns", "p99, ns", "p99.9, ns", "max, ns" );
+        for ( std::size_t kind = 0; kind < path_count; ++kind )
+        {
+            histogram total;
+            for ( auto& h : histograms ) total += h[ kind ];
+            if ( !total.total() ) continue;
+
+            auto ns = [ ticks_per_ns ]( std::uint64_t value ) { return static_cast< double >( value ) / ticks_per_ns; };
+            std::printf( "  %-14s %12llu %10.0f %10.0f %10.0f %12.0f\n", path_names[ kind ], static_cast< unsigned long long >( total.total() ),
+                ns( total.percentile( 50 ) ), ns( total.percentile( 99 ) ), ns( total.percentile( 99.9 ) ), ns( total.max() ) );
+        }
+    }
+
+
+    struct magazine_policy : public bits::default_policy
+    {
+        static constexpr std::size_t magazine_size = 32;
+    };
+
+    struct reserve_policy : public bits::default_policy
+    {
+        static constexpr std::size_t reserve_size = 16 * bits::default_policy::block_size;
+        static constexpr std::size_t reserve_low_watermark = 8 * bits::default_policy::block_size;
+    };
+}
+
+
+int main( int argc, char** argv )
+{
+    std::size_t thread_count = argc > 1 ? std::strtoull( argv[ 1 ], nullptr, 10 ) : std::max( 1u, std::thread::hardware_concurrency() );
+    std::size_t operations = argc > 2 ? std::strtoull( argv[ 2 ], nullptr, 10 ) : 1000000;
+    std::size_t large_rate = argc > 3 ? std::strtoull( argv[ 3 ], nullptr, 10 ) : 1;
+
+    auto ticks_per_ns = calibrate();
+
+    run< bits::default_policy >( "default policy", thread_count, operations, large_rate, ticks_per_ns );
+    run< magazine_policy >( "magazines", thread_count, operations, large_rate, ticks_per_ns );
+    run< reserve_policy >( "background reserve", thread_count, operations, large_rate, ticks_per_ns );
+
+    return 0;
+}
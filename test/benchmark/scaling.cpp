@@ -0,0 +1,231 @@
+// MIT License
+//
+// Copyright( c ) 2021 Alexey Pavlyutkin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+//
+// Measures scaling of lock_free_memory_resource with number of threads in the following patterns:
+//   local  - every thread releases pieces it has allocated
+//   handoff - every thread hands allocated pieces over to the next thread to be released there
+//   cross  - every thread hands allocated pieces over to a random thread
+//
+// usage: scaling_benchmark [max number of threads] [number of allocations per thread]
+//
+
+
+#include <lfmr/lock_free_memory_resource.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+
+namespace
+{
+    using bits::event;
+
+    // per-thread counters of contention events
+    struct event_counters
+    {
+        std::uint64_t pool_cas_retries_ = 0;
+        std::uint64_t garbage_cas_retries_ = 0;
+        std::uint64_t hazard_spins_ = 0;
+        std::uint64_t hazard_yields_ = 0;
+    };
+
+    thread_local event_counters local_counters;
+
+
+    struct scaling_policy : public bits::default_policy
+    {
+        static void on_event( event e ) noexcept
+        {
+            switch ( e )
+            {
+            case event::pool_cas_retry: ++local_counters.pool_cas_retries_; break;
+            case event::garbage_cas_retry: ++local_counters.garbage_cas_retries_; break;
+            case event::hazard_spin: ++local_counters.hazard_spins_; break;
+            case event::hazard_yield: ++local_counters.hazard_yields_; break;
+            default: break;
+            }
+        }
+    };
+
+    using memory_resource_type = bits::lock_free_memory_resource< scaling_policy >;
+
+
+    // released piece
+    struct piece
+    {
+        void* p_;
+        std::size_t size_;
+    };
+
+
+    // single producer single consumer queue of pieces to be released by another thread
+    class piece_queue
+    {
+        static constexpr std::size_t capacity_ = 1024;
+
+        alignas( bits::cache_line_size ) std::atomic< std::size_t > head_ = 0;
+        alignas( bits::cache_line_size ) std::atomic< std::size_t > tail_ = 0;
+        std::array< piece, capacity_ > pieces_;
+
+    public:
+
+        bool push( const piece& value ) noexcept
+        {
+            auto tail = tail_.load( std::memory_order_relaxed );
+            if ( tail - head_.load( std::memory_order_acquire ) == capacity_ ) return false;
+            pieces_[ tail % capacity_ ] = value;
+            tail_.store( tail + 1, std::memory_order_release );
+            return true;
+        }
+
+        bool pop( piece& value ) noexcept
+        {
+            auto head = head_.load( std::memory_order_relaxed );
+            if ( head == tail_.load( std::memory_order_acquire ) ) return false;
+            value = pieces_[ head % capacity_ ];
+            head_.store( head + 1, std::memory_order_release );
+            return true;
+        }
+    };
+
+
+    enum class pattern { local, handoff, cross };
+
+    struct result
+    {
+        double ops_per_second_ = 0;
+        event_counters counters_;
+    };
+
+
+    result run( pattern kind, std::size_t thread_count, std::size_t allocations )
+    {
+        memory_resource_type mr;
+
+        // queues[ from * thread_count + to ] carries pieces from one thread to another
+        std::vector< std::unique_ptr< piece_queue > > queues( thread_count * thread_count );
+        for ( auto& queue : queues ) queue = std::make_unique< piece_queue >();
+
+        std::atomic< std::size_t > ready = 0, producing = thread_count;
+        std::vector< event_counters > counters( thread_count );
+
+        auto worker = [ & ]( std::size_t self ) {
+            std::mt19937 random( static_cast< unsigned >( self ) );
+            std::uniform_int_distribution< std::size_t > sizes( 16, 512 ), targets( 0, thread_count - 1 );
+            local_counters = event_counters();
+
+            // releases all the pieces handed over to this thread
+            auto drain = [ & ]() {
+                bool drained = false;
+                piece incoming;
+                for ( std::size_t from = 0; from < thread_count; ++from )
+                {
+                    while ( queues[ from * thread_count + self ]->pop( incoming ) )
+                    {
+                        mr.deallocate( incoming.p_, incoming.size_ );
+                        drained = true;
+                    }
+                }
+                return drained;
+            };
+
+            ready.fetch_add( 1 );
+            while ( ready.load() < thread_count ) std::this_thread::yield();
+
+            for ( std::size_t i = 0; i < allocations; ++i )
+            {
+                piece allocated{ nullptr, sizes( random ) };
+                allocated.p_ = mr.allocate( allocated.size_ );
+
+                if ( kind == pattern::local )
+                {
+                    mr.deallocate( allocated.p_, allocated.size_ );
+                    continue;
+                }
+
+                auto target = kind == pattern::handoff ? ( self + 1 ) % thread_count : targets( random );
+                while ( !queues[ self * thread_count + target ]->push( allocated ) ) drain();
+                drain();
+            }
+
+            // keep releasing pieces till all the threads complete allocations
+            producing.fetch_sub( 1 );
+            while ( producing.load() ) if ( !drain() ) std::this_thread::yield();
+            drain();
+
+            counters[ self ] = local_counters;
+        };
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector< std::thread > threads;
+        for ( std::size_t t = 0; t < thread_count; ++t ) threads.emplace_back( worker, t );
+        for ( auto& thread : threads ) thread.join();
+        auto elapsed = std::chrono::duration< double >( std::chrono::steady_clock::now() - start ).count();
+
+        result r;
+        r.ops_per_second_ = static_cast< double >( thread_count * allocations ) / elapsed;
+        for ( auto& c : counters )
+        {
+            r.counters_.pool_cas_retries_ += c.pool_cas_retries_;
+            r.counters_.garbage_cas_retries_ += c.garbage_cas_retries_;
+            r.counters_.hazard_spins_ += c.hazard_spins_;
+            r.counters_.hazard_yields_ += c.hazard_yields_;
+        }
+        return r;
+    }
+}
+
+
+int main( int argc, char** argv )
+{
+    std::size_t max_threads = argc > 1 ? std::strtoull( argv[ 1 ], nullptr, 10 ) : std::max( 1u, std::thread::hardware_concurrency() );
+    std::size_t allocations = argc > 2 ? std::strtoull( argv[ 2 ], nullptr, 10 ) : 1000000;
+
+    std::printf( "%-8s %7s %14s %10s %12s %12s %12s %12s\n", "pattern", "threads", "ops/s", "efficiency", "pool retry", "garbage retry", "spins", "yields" );
+    for ( auto [ kind, name ] : { std::make_pair( pattern::local, "local" ), std::make_pair( pattern::handoff, "handoff" ), std::make_pair( pattern::cross, "cross" ) } )
+    {
+        double single = 0;
+        for ( std::size_t threads = 1; threads <= max_threads; threads *= 2 )
+        {
+            auto r = run( kind, threads, allocations );
+            if ( threads == 1 ) single = r.ops_per_second_;
+            std::printf( "%-8s %7zu %14.0f %9.1f%% %12llu %12llu %12llu %12llu\n",
+                name, threads, r.ops_per_second_, 100.0 * r.ops_per_second_ / ( single * threads ),
+                static_cast< unsigned long long >( r.counters_.pool_cas_retries_ ),
+                static_cast< unsigned long long >( r.counters_.garbage_cas_retries_ ),
+                static_cast< unsigned long long >( r.counters_.hazard_spins_ ),
+                static_cast< unsigned long long >( r.counters_.hazard_yields_ ) );
+            if ( threads < max_threads && threads * 2 > max_threads ) threads = max_threads / 2;
+        }
+    }
+
+    return 0;
+}
@@ -42,15 +42,26 @@ namespace bits
 
             static constexpr auto granularity = HeapType::granularity_;
             static constexpr auto piece_internal_fields_size = HeapType::piece_internal_fields_size_;
+            static constexpr auto piece_trailer_size = HeapType::piece_trailer_size_;
             inline static const auto pool_block_size = HeapType::pool_block_size();
             inline static const auto pool_block_capacity = HeapType::pool_block_capacity();
             static constexpr auto pool_block_header_size = HeapType::ceil( sizeof( pool_block_header_type ), granularity );
+            static constexpr auto garbage_exact_bin_count = HeapType::garbage_exact_bin_count_;
+            static constexpr auto garbage_bin_count = HeapType::garbage_bin_count_;
+            static constexpr auto garbage_bin_limits = HeapType::garbage_bin_limits_;
 
+            static size_type system_page_size() noexcept { return HeapType::system_page_size(); }
+            static size_type huge_page_size() noexcept { return HeapType::huge_page_size(); }
             static pointer_type ceil( pointer_type value, size_type mod ) noexcept { return HeapType::ceil( value, mod ); }
             static pointer_type floor( pointer_type value, size_type mod ) noexcept { return HeapType::floor( value, mod ); }
             static pointer_type& get_block_header_ptr_ref( pointer_type piece ) noexcept { return HeapType::get_block_header_ptr_ref( piece ); }
+            static std::int32_t current_cpu() noexcept { return HeapType::current_cpu(); }
             static void* virtual_alloc( size_type size, void* desire = nullptr ) { return HeapType::virtual_alloc( size, desire ); }
             static void virtual_free( void* p, size_type size ) noexcept { return HeapType::virtual_free( p, size ); }
+            static void* allocate_on_pool( HeapType& heap, std::size_t bytes, std::size_t alignment ) { return heap.allocate_on_pool( bytes, alignment ); }
+            static void* allocate_on_garbage( HeapType& heap, std::size_t bytes, std::size_t alignment ) noexcept { return heap.allocate_on_garbage( bytes, alignment ); }
+            static void* allocate_large_block( HeapType& heap, std::size_t bytes, std::size_t alignment ) { return heap.allocate_large_block( bytes, alignment ); }
+            static void do_deallocate( HeapType& heap, void* p, std::size_t bytes, std::size_t alignment ) { heap.do_deallocate( p, bytes, alignment ); }
 
         private:
 
@@ -78,14 +89,61 @@ namespace bits
                 pointer_type it_ = 0;
             };
 
+            struct bin_iterator
+            {
+                using iterator_category = std::forward_iterator_tag;
+                using value_type = garbage_block_header_type;
+                using difference_type = ptrdiff_t;
+                using pointer = const value_type*;
+                using reference = const value_type&;
+                using self_type = bin_iterator;
+
+                bin_iterator() noexcept = default;
+                bin_iterator( const HeapType& heap, size_type bin ) noexcept : heap_( &heap ), bin_( bin ) { skip(); }
+                reference operator*() const noexcept { return *it_; }
+                pointer operator->() const noexcept { return &*it_; }
+                self_type& operator++() noexcept { ++it_; skip(); return *this; }
+                self_type operator++( int ) noexcept { self_type tmp = *this; ++( *this ); return tmp; }
+                bool friend operator==( const self_type& lhs, const self_type& rhs ) noexcept { return lhs.it_ == rhs.it_; }
+                bool friend operator!=( const self_type& lhs, const self_type& rhs ) noexcept { return !( lhs == rhs ); }
+                explicit operator pointer_type() const noexcept { return static_cast< pointer_type >( it_ ); }
+
+            private:
+                // proceeds to the next non-empty bin if current one is over
+                void skip() noexcept
+                {
+                    for ( ; it_ == iterator< garbage_block_header_type >() && bin_ < HeapType::garbage_bin_count_; ++bin_ )
+                    {
+                        it_ = iterator< garbage_block_header_type >( heap_->garbage_[ bin_ ].head_ );
+                    }
+                }
+
+                const HeapType* heap_ = nullptr;
+                size_type bin_ = 0;
+                iterator< garbage_block_header_type > it_;
+            };
+
         public:
 
             using pool_iterator = iterator< pool_block_header_type >;
-            using garbage_iterator = iterator< garbage_block_header_type >;
+            using garbage_iterator = bin_iterator;
 
             static pool_iterator pool_begin( const HeapType& lock_free_memory_resource ) noexcept { return pool_iterator( lock_free_memory_resource.pool_ ); }
             static pool_iterator pool_end( const HeapType& ) noexcept { return pool_iterator(); }
-            static garbage_iterator garbage_begin( const HeapType& lock_free_memory_resource ) noexcept { return garbage_iterator( lock_free_memory_resource.garbage_ ); }
+
+            static pool_iterator reserve_begin( const HeapType& lock_free_memory_resource ) noexcept { return pool_iterator( lock_free_memory_resource.reserve_ ); }
+            static pool_iterator reserve_end( const HeapType& ) noexcept { return pool_iterator(); }
+            static std::size_t reserve_bytes( const HeapType& lock_free_memory_resource ) noexcept { return lock_free_memory_resource.reserve_bytes_; }
+
+            static pointer_type slab_begin( const HeapType& lock_free_memory_resource ) noexcept { return lock_free_memory_resource.slab_arena_.begin_.load(); }
+            static pointer_type slab_end( const HeapType& lock_free_memory_resource ) noexcept { auto begin = slab_begin( lock_free_memory_resource ); return begin ? begin + HeapType::slab_arena_size() : 0; }
+            static size_type slab_run_size() noexcept { return HeapType::slab_run_size(); }
+            static size_type slab_class_size( void* p ) noexcept { return reinterpret_cast< typename HeapType::slab_run_header* >( HeapType::floor( reinterpret_cast< pointer_type >( p ), HeapType::slab_run_size() ) )->size_; }
+            static pointer_type heap_begin( const HeapType& lock_free_memory_resource ) noexcept { return lock_free_memory_resource.heap_arena_.begin_.load(); }
+            static pointer_type heap_end( const HeapType& lock_free_memory_resource ) noexcept { auto begin = heap_begin( lock_free_memory_resource ); return begin ? begin + HeapType::heap_arena_size() : 0; }
+
+            // iterates garbage blocks bin by bin in ascending order of size
+            static garbage_iterator garbage_begin( const HeapType& lock_free_memory_resource ) noexcept { return garbage_iterator( lock_free_memory_resource, 0 ); }
             static garbage_iterator garbage_end( const HeapType& ) noexcept { return garbage_iterator(); }
 
             static std::size_t pool_size( const HeapType& lock_free_memory_resource ) noexcept
@@ -101,6 +159,33 @@ namespace bits
                 for ( auto it = garbage_begin( lock_free_memory_resource ), end = garbage_end( lock_free_memory_resource ); it != end; ++it, ++sz );
                 return sz;
             }
+
+            static std::size_t large_registry_size( const HeapType& lock_free_memory_resource ) noexcept
+            {
+                std::size_t sz = 0;
+                for ( auto chunk = lock_free_memory_resource.large_blocks_.load(); chunk; chunk = chunk->next_, ++sz );
+                return sz;
+            }
+
+            static std::size_t thread_state_count( const HeapType& lock_free_memory_resource ) noexcept
+            {
+                std::size_t sz = 0;
+                for ( auto state = lock_free_memory_resource.threads_.load(); state; state = state->next_, ++sz );
+                return sz;
+            }
+
+            static void disable_cpu_fence( HeapType& lock_free_memory_resource ) noexcept
+            {
+                lock_free_memory_resource.cpu_fence_ = false;
+            }
+
+            static std::size_t magazine_size( HeapType& lock_free_memory_resource )
+            {
+                std::size_t sz = 0;
+                auto state = lock_free_memory_resource.local_state();
+                for ( auto magazine = 0; magazine < HeapType::magazine_count_; sz += state->magazine_sizes_[ magazine++ ] );
+                return sz;
+            }
         };
     }
 }
@@ -23,13 +23,21 @@
 
 #include <gtest/gtest.h>
 #include "accessor.h"
+#include "policy.h"
 #include <lfmr/lock_free_memory_resource.h>
 #include <list>
 #include <stack>
 #include <tuple>
 #include <utility>
+#include <algorithm>
 #include <limits>
 #include <cstring>
+#include <thread>
+#include <vector>
+#include <chrono>
+#ifdef __linux__
+#   include <sys/mman.h>
+#endif
 
 
 namespace bits
@@ -78,24 +86,6 @@ namespace bits
 
         //-----------------------------------------------------------------------------------------------------------------------------------------------------
 
-        template < typename PolicyType, std::size_t BlockSize >
-        struct set_pool_block_size : public PolicyType
-        {
-            static constexpr std::size_t block_size = BlockSize;
-        };
-
-        template < typename PolicyType, std::size_t Granularity >
-        struct set_granularity : public PolicyType
-        {
-            static constexpr std::size_t granularity = Granularity;
-        };
-
-        template < typename PolicyType, std::size_t GarbageSearchDepth >
-        struct set_garbage_search_depth : public PolicyType
-        {
-            static constexpr std::size_t garbage_search_depth = GarbageSearchDepth;
-        };
-
         template < typename Policy, std::size_t Size, std::size_t Alignment, typename ExceptionType >
         struct test_invalid_arguments
         {
@@ -204,10 +194,10 @@ namespace bits
         {
             using policy_type = Policy;
             static constexpr bool is_allocate_on_garbage_test = true;
-            inline static const std::list< std::size_t > initial_garbage_state = { 3 * policy_type::granularity, policy_type::granularity, policy_type::granularity };
+            inline static const std::list< std::size_t > initial_garbage_state = { 3 * policy_type::granularity, 4 * policy_type::granularity, 4 * policy_type::granularity };
             static constexpr std::size_t requested_size = 1;
             static constexpr std::size_t requested_alignment = 1;
-            inline static const std::list< std::size_t > expected_garbage_state = { 2 * policy_type::granularity, policy_type::granularity, policy_type::granularity };
+            inline static const std::list< std::size_t > expected_garbage_state = { 2 * policy_type::granularity, 4 * policy_type::granularity, 4 * policy_type::granularity };
         };
 
         template < typename Policy >
@@ -215,10 +205,10 @@ namespace bits
         {
             using policy_type = Policy;
             static constexpr bool is_allocate_on_garbage_test = true;
-            inline static const std::list< std::size_t > initial_garbage_state = { 3 * policy_type::granularity, policy_type::granularity, policy_type::granularity };
+            inline static const std::list< std::size_t > initial_garbage_state = { 3 * policy_type::granularity, 4 * policy_type::granularity, 4 * policy_type::granularity };
             static constexpr std::size_t requested_size = policy_type::granularity - sizeof( ptrdiff_t ) - sizeof( intptr_t ) + 1;
             static constexpr std::size_t requested_alignment = sizeof( ptrdiff_t ) + sizeof( intptr_t );
-            inline static const std::list< std::size_t > expected_garbage_state = { policy_type::granularity, policy_type::granularity, policy_type::granularity };
+            inline static const std::list< std::size_t > expected_garbage_state = { policy_type::granularity, 4 * policy_type::granularity, 4 * policy_type::granularity };
         };
 
         template < typename Policy >
@@ -226,10 +216,10 @@ namespace bits
         {
             using policy_type = Policy;
             static constexpr bool is_allocate_on_garbage_test = true;
-            inline static const std::list< std::size_t > initial_garbage_state = { policy_type::granularity, 3 * policy_type::granularity, policy_type::granularity };
+            inline static const std::list< std::size_t > initial_garbage_state = { 4 * policy_type::granularity, 3 * policy_type::granularity, 4 * policy_type::granularity };
             static constexpr std::size_t requested_size = policy_type::granularity - sizeof( ptrdiff_t ) - sizeof( intptr_t ) + 1;
             static constexpr std::size_t requested_alignment = sizeof( ptrdiff_t ) + sizeof( intptr_t );
-            inline static const std::list< std::size_t > expected_garbage_state = { policy_type::granularity, policy_type::granularity, policy_type::granularity };
+            inline static const std::list< std::size_t > expected_garbage_state = { policy_type::granularity, 4 * policy_type::granularity, 4 * policy_type::granularity };
         };
 
         template < typename Policy >
@@ -237,10 +227,20 @@ namespace bits
         {
             using policy_type = Policy;
             static constexpr bool is_allocate_on_garbage_test = true;
-            inline static const std::list< std::size_t > initial_garbage_state = { policy_type::granularity, policy_type::granularity, 3 * policy_type::granularity, };
+            inline static const std::list< std::size_t > initial_garbage_state = { 4 * policy_type::granularity, 4 * policy_type::granularity, 3 * policy_type::granularity, };
             static constexpr std::size_t requested_size = policy_type::granularity - sizeof( ptrdiff_t ) - sizeof( intptr_t ) + 1;
             static constexpr std::size_t requested_alignment = sizeof( ptrdiff_t ) + sizeof( intptr_t );
-            inline static const std::list< std::size_t > expected_garbage_state = { policy_type::granularity, policy_type::granularity, policy_type::granularity };
+            inline static const std::list< std::size_t > expected_garbage_state = { policy_type::granularity, 4 * policy_type::granularity, 4 * policy_type::granularity };
+        };
+
+        // blocks from the lowest and the highest sizes of the first geometric garbage bin
+        template < typename Policy >
+        struct geometric_garbage_bin
+        {
+            using accessor_type = accessor< lock_free_memory_resource< Policy > >;
+            static constexpr std::size_t exact_bin_count = accessor_type::garbage_exact_bin_count;
+            static constexpr std::size_t small_block = accessor_type::garbage_bin_limits[ exact_bin_count - 1 ] + Policy::granularity;
+            static constexpr std::size_t large_block = accessor_type::garbage_bin_limits[ exact_bin_count ];
         };
 
         template < typename Policy >
@@ -249,20 +249,39 @@ namespace bits
             using policy_type = Policy;
             static constexpr bool is_allocate_on_garbage_test = true;
             inline static const std::list< std::size_t > initial_garbage_state = []() {
-                std::list< std::size_t > result( policy_type::garbage_search_depth, policy_type::granularity );
-                result.emplace_back( 2 * policy_type::granularity );
+                std::list< std::size_t > result( policy_type::garbage_search_depth, geometric_garbage_bin< policy_type >::small_block );
+                result.emplace_back( geometric_garbage_bin< policy_type >::large_block );
                 return result;
             }( );
-            static constexpr std::size_t requested_size = policy_type::granularity - sizeof( ptrdiff_t ) - sizeof( intptr_t ) + 1;
+            static constexpr std::size_t requested_size = geometric_garbage_bin< policy_type >::large_block - sizeof( ptrdiff_t ) - sizeof( intptr_t );
             static constexpr std::size_t requested_alignment = sizeof( ptrdiff_t ) + sizeof( intptr_t );
             inline static const std::list< std::size_t > expected_garbage_state = []() {
-                std::list< std::size_t > result( policy_type::garbage_search_depth, policy_type::granularity );
+                std::list< std::size_t > result( policy_type::garbage_search_depth, geometric_garbage_bin< policy_type >::small_block );
                 return result;
             }( );
         };
 
         template < typename Policy >
         struct test_allocate_on_garbage_search_depth_break
+        {
+            using policy_type = Policy;
+            static constexpr bool is_allocate_on_garbage_test = true;
+            inline static const std::list< std::size_t > initial_garbage_state = []() {
+                std::list< std::size_t > result( policy_type::garbage_search_depth + 1, geometric_garbage_bin< policy_type >::small_block );
+                result.emplace_back( geometric_garbage_bin< policy_type >::large_block );
+                return result;
+            }( );
+            static constexpr std::size_t requested_size = geometric_garbage_bin< policy_type >::large_block - sizeof( ptrdiff_t ) - sizeof( intptr_t );
+            static constexpr std::size_t requested_alignment = sizeof( ptrdiff_t ) + sizeof( intptr_t );
+            inline static const std::list< std::size_t > expected_garbage_state = []() {
+                std::list< std::size_t > result( policy_type::garbage_search_depth + 1, geometric_garbage_bin< policy_type >::small_block );
+                result.emplace_back( geometric_garbage_bin< policy_type >::large_block );
+                return result;
+            }( );
+        };
+
+        template < typename Policy >
+        struct test_allocate_on_exact_garbage_bin
         {
             using policy_type = Policy;
             static constexpr bool is_allocate_on_garbage_test = true;
@@ -275,7 +294,6 @@ namespace bits
             static constexpr std::size_t requested_alignment = sizeof( ptrdiff_t ) + sizeof( intptr_t );
             inline static const std::list< std::size_t > expected_garbage_state = []() {
                 std::list< std::size_t > result( policy_type::garbage_search_depth + 1, policy_type::granularity );
-                result.emplace_back( 2 * policy_type::granularity );
                 return result;
             }( );
         };
@@ -290,6 +308,160 @@ namespace bits
             static constexpr std::size_t requested_alignment = 1;
         };
 
+        template < typename Policy >
+        struct test_magazine
+        {
+            using policy_type = Policy;
+            static constexpr bool is_magazine_test = true;
+        };
+
+        template < typename Policy >
+        struct test_coalescing
+        {
+            using policy_type = Policy;
+            static constexpr bool is_coalescing_test = true;
+        };
+
+        template < typename Policy >
+        struct test_trim
+        {
+            using policy_type = Policy;
+            static constexpr bool is_trim_test = true;
+        };
+
+        template < typename Policy >
+        struct test_reserve
+        {
+            using policy_type = Policy;
+            static constexpr bool is_reserve_test = true;
+        };
+
+        template < typename Policy >
+        struct test_statistics
+        {
+            using policy_type = Policy;
+            static constexpr bool is_statistics_test = true;
+        };
+
+        template < typename Policy >
+        struct test_snapshot
+        {
+            using policy_type = Policy;
+            static constexpr bool is_snapshot_test = true;
+        };
+
+        template < typename Policy >
+        struct test_huge_pages
+        {
+            using policy_type = Policy;
+            static constexpr bool is_huge_pages_test = true;
+        };
+
+        template < typename Policy >
+        struct test_slab
+        {
+            using policy_type = Policy;
+            static constexpr bool is_slab_test = true;
+        };
+
+        template < typename Policy >
+        struct test_slab_large_class
+        {
+            using policy_type = Policy;
+            static constexpr bool is_slab_large_class_test = true;
+        };
+
+        template < typename Policy >
+        struct test_trusted_size
+        {
+            using policy_type = Policy;
+            static constexpr bool is_trusted_size_test = true;
+        };
+
+        template < typename Policy >
+        struct test_bulk
+        {
+            using policy_type = Policy;
+            static constexpr bool is_bulk_test = true;
+        };
+
+        template < typename Policy >
+        struct test_release
+        {
+            using policy_type = Policy;
+            static constexpr bool is_release_test = true;
+        };
+
+        template < typename Policy >
+        struct test_rewind
+        {
+            using policy_type = Policy;
+            static constexpr bool is_rewind_test = true;
+        };
+
+        template < typename Policy >
+        struct test_large_cache
+        {
+            using policy_type = Policy;
+            static constexpr bool is_large_cache_test = true;
+        };
+
+        template < typename Policy >
+        struct test_reallocate
+        {
+            using policy_type = Policy;
+            static constexpr bool is_reallocate_test = true;
+        };
+
+        template < typename Policy >
+        struct test_allocate_at_least
+        {
+            using policy_type = Policy;
+            static constexpr bool is_allocate_at_least_test = true;
+        };
+
+        template < typename Policy >
+        struct test_allocate_zeroed
+        {
+            using policy_type = Policy;
+            static constexpr bool is_allocate_zeroed_test = true;
+        };
+
+        template < typename Policy >
+        struct test_over_alignment
+        {
+            using policy_type = Policy;
+            static constexpr bool is_over_alignment_test = true;
+        };
+
+        template < typename Policy >
+        struct test_tlab
+        {
+            using policy_type = Policy;
+            static constexpr bool is_tlab_test = true;
+        };
+
+        template < typename Policy >
+        struct test_thread_heap
+        {
+            using policy_type = Policy;
+            static constexpr bool is_thread_heap_test = true;
+        };
+
+        template < typename Policy >
+        struct test_cpu_caches
+        {
+            using policy_type = Policy;
+            static constexpr bool is_cpu_caches_test = true;
+        };
+
+        template < typename Policy >
+        struct test_purge_decay
+        {
+            using policy_type = Policy;
+            static constexpr bool is_purge_decay_test = true;
+        };
+
         using test_types = ::testing::Types <
 
             // test on invalid arguments
@@ -306,8 +478,8 @@ namespace bits
             test_invalid_arguments< default_policy, 1, 255, std::invalid_argument >,
             test_invalid_arguments< default_policy, 1, 257, std::invalid_argument >,
 #endif
-            test_invalid_arguments< default_policy, 1, 1 << 17, std::invalid_argument >,
-            test_invalid_arguments< set_pool_block_size< default_policy, 1 << 17 >, 1, 1 << 18, std::invalid_argument >,
+            test_invalid_arguments< default_policy, 1, std::size_t( 1 ) << 63, std::invalid_argument >,
+            test_invalid_arguments< default_policy, 1, std::size_t( 1 ) << 62, std::bad_alloc >,
             test_invalid_arguments< default_policy, std::numeric_limits< ptrdiff_t >::max(), 1, std::bad_alloc >,
 
             // allocation on pool
@@ -385,8 +557,107 @@ namespace bits
             test_allocate_on_garbage_search_depth_in< default_policy >,
             test_allocate_on_garbage_search_depth_break< default_policy >,
 
+            // exact garbage bins do not need search
+            test_allocate_on_exact_garbage_bin< set_garbage_search_depth< default_policy, 4 > >,
+            test_allocate_on_exact_garbage_bin< default_policy >,
+
             //
-            test_allocate_deallocate_large_block< default_policy >
+            test_allocate_deallocate_large_block< default_policy >,
+
+            // per-thread magazines
+            test_magazine< set_magazine_size< default_policy, 4 > >,
+            test_magazine< set_magazine_size< set_granularity< default_policy, 0x100 >, 16 > >,
+
+            // coalescing
+            test_coalescing< set_coalescing< default_policy, true > >,
+            test_coalescing< set_coalescing< set_granularity< default_policy, 0x100 >, true > >,
+            test_coalescing< set_coalescing< set_pool_block_size< default_policy, 1 << 20 >, true > >,
+
+            // returning memory to OS
+            test_trim< default_policy >,
+            test_trim< set_coalescing< default_policy, true > >,
+            test_purge_decay< set_purge_decay< default_policy, 1 > >,
+
+            // huge pages
+            test_allocate_deallocate_on_pool< set_huge_pages< default_policy, true >, 1, 1 >,
+            test_allocate_deallocate_on_pool< set_huge_pages< default_policy, true >, use_max_piece_size_on_pool, 1 >,
+            test_allocate_deallocate_large_block< set_huge_pages< default_policy, true > >,
+            test_huge_pages< set_huge_pages< default_policy, true > >,
+            test_huge_pages< set_huge_pages< set_pool_block_size< default_policy, 1 << 21 >, true > >,
+            test_huge_pages< set_statistics< set_huge_pages< set_large_cache< default_policy, 1 << 24, 0 >, true >, true > >,
+
+            // background pool replenishing
+            test_reserve< set_reserve_size< default_policy, 4 * default_policy::block_size, 2 * default_policy::block_size > >,
+            test_reserve< set_reserve_size< default_policy, default_policy::block_size, 0 > >,
+
+            // statistics
+            test_statistics< default_policy >,
+            test_statistics< set_statistics< default_policy, true > >,
+            test_statistics< set_statistics< set_magazine_size< default_policy, 4 >, true > >,
+
+            // memory usage snapshot
+            test_snapshot< default_policy >,
+            test_snapshot< set_granularity< default_policy, 0x100 > >,
+
+            // headerless slabs
+            test_slab< set_slab_max_size< default_policy, 256 > >,
+            test_slab< set_slab_max_size< set_statistics< default_policy, true >, 64 > >,
+            test_slab_large_class< set_slab_max_size< default_policy, 8192 > >,
+
+            // headerless pieces of trusted size
+            test_trusted_size< set_trusted_size< default_policy, true > >,
+            test_trusted_size< set_trusted_size< set_magazine_size< default_policy, 4 >, true > >,
+            test_trusted_size< set_trusted_size< set_coalescing< default_policy, true >, true > >,
+
+            // bulk allocation
+            test_bulk< set_statistics< default_policy, true > >,
+            test_bulk< set_statistics< set_trusted_size< default_policy, true >, true > >,
+            test_bulk< set_statistics< set_slab_max_size< default_policy, 64 >, true > >,
+
+            // release of all the allocated memory
+            test_release< default_policy >,
+            test_release< set_magazine_size< set_slab_max_size< default_policy, 64 >, 4 > >,
+            test_release< set_trusted_size< default_policy, true > >,
+
+            // checkpoint and rewind
+            test_rewind< default_policy >,
+            test_rewind< set_magazine_size< default_policy, 4 > >,
+            test_rewind< set_coalescing< default_policy, true > >,
+
+            // cache of released large blocks
+            test_large_cache< set_statistics< set_large_cache< default_policy, 1 << 22, 0 >, true > >,
+            test_large_cache< set_statistics< set_large_cache< default_policy, 1 << 22, 10 >, true > >,
+
+            // in-place resizing
+            test_reallocate< set_statistics< default_policy, true > >,
+            test_reallocate< set_statistics< set_trusted_size< default_policy, true >, true > >,
+            test_reallocate< set_statistics< set_slab_max_size< default_policy, 64 >, true > >,
+
+            // usable size
+            test_allocate_at_least< default_policy >,
+            test_allocate_at_least< set_granularity< default_policy, 0x100 > >,
+            test_allocate_at_least< set_trusted_size< default_policy, true > >,
+            test_allocate_at_least< set_slab_max_size< default_policy, 64 > >,
+
+            // zero-filled allocation
+            test_allocate_zeroed< set_statistics< default_policy, true > >,
+            test_allocate_zeroed< set_statistics< set_trusted_size< default_policy, true >, true > >,
+            test_allocate_zeroed< set_statistics< set_large_cache< default_policy, 1 << 26, 0 >, true > >,
+
+            // alignment exceeding page size
+            test_over_alignment< default_policy >,
+            test_over_alignment< set_trusted_size< default_policy, true > >,
+            test_over_alignment< set_large_cache< default_policy, 1 << 26, 0 > >,
+
+            // per-thread bump chunks
+            test_tlab< set_statistics< set_tlab_size< default_policy, 4096 >, true > >,
+            test_tlab< set_statistics< set_tlab_size< set_trusted_size< default_policy, true >, 4096 >, true > >,
+            test_thread_heap< set_statistics< set_heap_block_size< default_policy, 1 << 16 >, true > >,
+            test_thread_heap< set_statistics< set_heap_block_size< set_trusted_size< default_policy, true >, 1 << 16 >, true > >,
+            test_cpu_caches< set_statistics< set_cpu_caches< set_magazine_size< default_policy, 4 >, true >, true > >,
+            test_cpu_caches< set_statistics< set_cpu_caches< set_magazine_size< set_trusted_size< default_policy, true >, 4 >, true >, true > >,
+            test_cpu_caches< set_statistics< set_cpu_caches< set_tlab_size< default_policy, 4096 >, true >, true > >,
+            test_cpu_caches< set_statistics< set_cpu_caches< set_tlab_size< set_magazine_size< default_policy, 4 >, 4096 >, true >, true > >
         >;
 
         TYPED_TEST_SUITE( test_heap, test_types, );
@@ -680,8 +951,12 @@ namespace bits
                     while ( !pieces.empty() )
                     {
                         auto [p, piece_size, alignment, block_size] = pieces.top();
+                        auto [ block_head, actual_block_size ] = test_heap< U >::get_piece_internal_fields( p );
+                        ASSERT_EQ( static_cast< typename accessor_type::size_type >( block_size ), actual_block_size );
                         mr.deallocate( p, piece_size, 1 );
-                        ASSERT_EQ( static_cast< typename accessor_type::size_type >( block_size ), accessor_type::garbage_begin( mr )->size_ );
+                        auto it = accessor_type::garbage_begin( mr );
+                        for ( ; it != accessor_type::garbage_end( mr ) && static_cast< typename accessor_type::pointer_type >( it ) != block_head; ++it );
+                        ASSERT_NE( accessor_type::garbage_end( mr ), it );
                         pieces.pop();
                     }
                     ASSERT_EQ( initial_garbage_state.size(), accessor_type::garbage_size( mr ) );
@@ -780,6 +1055,1998 @@ namespace bits
 
         //-----------------------------------------------------------------------------------------------------------------------------------------------------
 
+        template < typename T >
+        struct magazine_impl
+        {
+            static void run( ... ) noexcept {}
+
+            template < typename U >
+            static void run(
+                U&&,
+                decltype( U::is_magazine_test ) = U::is_magazine_test
+            ) noexcept
+            {
+                using policy_type = typename U::policy_type;
+                using memory_resource_type = typename test_heap< U >::memory_resource_type;
+                using accessor_type = typename test_heap< U >::accessor_type;
+
+                try
+                {
+                    memory_resource_type mr;
+                    constexpr auto magazine_size = policy_type::magazine_size;
+                    constexpr auto batch = magazine_size / 2;
+
+                    // fill up a magazine
+                    std::list< void* > pieces;
+                    for ( std::size_t i = 0; i < magazine_size; ++i )
+                    {
+                        pieces.push_back( mr.allocate( 1, 1 ) );
+                        test_heap< U >::check_memory_piece( pieces.back(), 1, 1 );
+                    }
+                    for ( std::size_t i = 1; i < magazine_size; ++i )
+                    {
+                        mr.deallocate( pieces.front(), 1, 1 );
+                        pieces.pop_front();
+                    }
+
+                    // released pieces stay in the magazine
+                    EXPECT_EQ( 0, accessor_type::garbage_size( mr ) );
+                    EXPECT_EQ( magazine_size - 1, accessor_type::magazine_size( mr ) );
+
+                    // full magazine goes to garbage
+                    mr.deallocate( pieces.front(), 1, 1 );
+                    pieces.pop_front();
+                    EXPECT_EQ( magazine_size, accessor_type::garbage_size( mr ) );
+                    EXPECT_EQ( 0, accessor_type::magazine_size( mr ) );
+
+                    // empty magazine takes a batch from garbage
+                    auto p = mr.allocate( 1, 1 );
+                    test_heap< U >::check_memory_piece( p, 1, 1 );
+                    EXPECT_EQ( magazine_size - batch, accessor_type::garbage_size( mr ) );
+                    EXPECT_EQ( batch - 1, accessor_type::magazine_size( mr ) );
+                    mr.deallocate( p, 1, 1 );
+
+                    // magazines of exited thread get flushed to garbage
+                    std::size_t sz = policy_type::granularity;
+                    std::thread( [&]() {
+                        auto p = mr.allocate( sz, 1 );
+                        test_heap< U >::check_memory_piece( p, sz, 1 );
+                        mr.deallocate( p, sz, 1 );
+                    } ).join();
+                    EXPECT_EQ( magazine_size - batch + 1, accessor_type::garbage_size( mr ) );
+                    auto it = accessor_type::garbage_begin( mr );
+                    std::advance( it, magazine_size - batch );
+                    EXPECT_EQ( static_cast< typename accessor_type::size_type >( 2 * policy_type::granularity ), it->size_ );
+                }
+                catch ( ... )
+                {
+                    GTEST_FAIL();
+                }
+            }
+
+            void operator()() const noexcept { run( T() ); }
+        };
+
+        TYPED_TEST( test_heap, magazine )
+        {
+            magazine_impl< TypeParam >()( );
+        }
+
+        //-----------------------------------------------------------------------------------------------------------------------------------------------------
+
+        template < typename T >
+        struct coalescing_impl
+        {
+            static void run( ... ) noexcept {}
+
+            template < typename U >
+            static void run(
+                U&&,
+                decltype( U::is_coalescing_test ) = U::is_coalescing_test
+            ) noexcept
+            {
+                using policy_type = typename U::policy_type;
+                using memory_resource_type = typename test_heap< U >::memory_resource_type;
+                using accessor_type = typename test_heap< U >::accessor_type;
+                using size_type = typename accessor_type::size_type;
+
+                try
+                {
+                    {
+                        memory_resource_type mr;
+                        auto pool_head = accessor_type::pool_begin( mr );
+                        auto initial_unallocated = pool_head->unallocated_.load();
+
+                        // fragment the pool block with small pieces followed by a fence piece
+                        constexpr std::size_t piece_count = 64;
+                        std::vector< void* > pieces;
+                        for ( std::size_t i = 0; i < piece_count; ++i ) pieces.push_back( mr.allocate( 1, 1 ) );
+                        auto fence = mr.allocate( 1, 1 );
+                        auto first_block_head = std::get< 0 >( test_heap< U >::get_piece_internal_fields( pieces.front() ) );
+
+                        // release the pieces in mixed order
+                        for ( std::size_t i = 0; i < piece_count; i += 2 ) mr.deallocate( pieces[ i ], 1, 1 );
+                        for ( std::size_t i = 1; i < piece_count; i += 2 ) mr.deallocate( pieces[ i ], 1, 1 );
+                        ASSERT_EQ( piece_count, accessor_type::garbage_size( mr ) );
+                        for ( auto it = accessor_type::garbage_begin( mr ); it != accessor_type::garbage_end( mr ); ++it )
+                        {
+                            EXPECT_EQ( static_cast< size_type >( policy_type::granularity ), it->size_ );
+                        }
+
+                        // the fragments get merged into the single block
+                        EXPECT_TRUE( mr.coalesce() );
+                        ASSERT_EQ( 1, accessor_type::garbage_size( mr ) );
+                        EXPECT_EQ( static_cast< size_type >( piece_count * policy_type::granularity ), accessor_type::garbage_begin( mr )->size_ );
+                        EXPECT_EQ( static_cast< typename accessor_type::pointer_type >( accessor_type::garbage_begin( mr ) ), first_block_head );
+
+                        // which can serve large request without touching the pool
+                        auto unallocated = pool_head->unallocated_.load();
+                        std::size_t sz = piece_count * policy_type::granularity - accessor_type::piece_internal_fields_size;
+                        auto p = mr.allocate( sz, 1 );
+                        test_heap< U >::check_memory_piece( p, sz, 1 );
+                        EXPECT_EQ( unallocated, pool_head->unallocated_ );
+                        EXPECT_EQ( 0, accessor_type::garbage_size( mr ) );
+
+                        // nothing to merge
+                        EXPECT_FALSE( mr.coalesce() );
+
+                        // blocks adjacent to unallocated area go back to the pool
+                        mr.deallocate( p, sz, 1 );
+                        mr.deallocate( fence, 1, 1 );
+                        EXPECT_TRUE( mr.coalesce() );
+                        EXPECT_EQ( 0, accessor_type::garbage_size( mr ) );
+                        EXPECT_EQ( initial_unallocated, pool_head->unallocated_ );
+                    }
+
+                    {
+                        memory_resource_type mr;
+
+                        // fill up the pool block with small pieces
+                        std::vector< void* > pieces( accessor_type::pool_block_capacity / policy_type::granularity );
+                        for ( auto& piece : pieces ) piece = mr.allocate( 1, 1 );
+                        ASSERT_EQ( 1, accessor_type::pool_size( mr ) );
+                        for ( auto piece : pieces ) mr.deallocate( piece, 1, 1 );
+
+                        // fragmented garbage does not make the pool grow
+                        std::size_t sz = accessor_type::pool_block_capacity / 2;
+                        auto p = mr.allocate( sz, 1 );
+                        test_heap< U >::check_memory_piece( p, sz, 1 );
+                        EXPECT_EQ( 1, accessor_type::pool_size( mr ) );
+                        mr.deallocate( p, sz, 1 );
+                    }
+                }
+                catch ( ... )
+                {
+                    GTEST_FAIL();
+                }
+            }
+
+            void operator()() const noexcept { run( T() ); }
+        };
+
+        TYPED_TEST( test_heap, coalescing )
+        {
+            coalescing_impl< TypeParam >()( );
+        }
+
+        //-----------------------------------------------------------------------------------------------------------------------------------------------------
+
+        // checks if all the pages of given region are not backed by physical memory
+        inline bool is_purged( [[maybe_unused]] intptr_t begin, [[maybe_unused]] intptr_t end, [[maybe_unused]] ptrdiff_t page_size )
+        {
+#ifdef __linux__
+            for ( auto page = begin; page < end; page += page_size )
+            {
+                unsigned char resident = 0;
+                if ( ::mincore( reinterpret_cast< void* >( page ), page_size, &resident ) != 0 || ( resident & 1 ) ) return false;
+            }
+#endif
+            return true;
+        }
+
+        // checks if all the pages of given region are backed by physical memory
+        inline bool is_resident( [[maybe_unused]] intptr_t begin, [[maybe_unused]] intptr_t end, [[maybe_unused]] ptrdiff_t page_size )
+        {
+#ifdef __linux__
+            for ( auto page = begin; page < end; page += page_size )
+            {
+                unsigned char resident = 0;
+                if ( ::mincore( reinterpret_cast< void* >( page ), page_size, &resident ) != 0 || !( resident & 1 ) ) return false;
+            }
+#endif
+            return true;
+        }
+
+        template < typename T >
+        struct trim_impl
+        {
+            static void run( ... ) noexcept {}
+
+            template < typename U >
+            static void run(
+                U&&,
+                decltype( U::is_trim_test ) = U::is_trim_test
+            ) noexcept
+            {
+                using policy_type = typename U::policy_type;
+                using memory_resource_type = typename test_heap< U >::memory_resource_type;
+                using accessor_type = typename test_heap< U >::accessor_type;
+                using pointer_type = typename accessor_type::pointer_type;
+
+                try
+                {
+                    memory_resource_type mr;
+                    auto page_size = accessor_type::system_page_size();
+                    auto pool_head = accessor_type::pool_begin( mr );
+
+                    // nothing to return yet
+                    EXPECT_EQ( 0, mr.trim() );
+
+                    // allocate a piece followed by a fence and make its pages resident
+                    std::size_t sz = 4 * page_size;
+                    auto p = mr.allocate( sz, 1 );
+                    auto fence = mr.allocate( 1, 1 );
+                    test_heap< U >::check_memory_piece( p, sz, 1 );
+                    auto [ block_head, block_size ] = test_heap< U >::get_piece_internal_fields( p );
+                    auto purgeable_begin = accessor_type::ceil( block_head + sizeof( typename accessor_type::garbage_block_header_type ), page_size );
+                    auto purgeable_end = accessor_type::floor( block_head + block_size, page_size );
+                    mr.deallocate( p, sz, 1 );
+                    ASSERT_EQ( static_cast< pointer_type >( accessor_type::garbage_begin( mr ) ), block_head );
+                    EXPECT_NE( 0, accessor_type::garbage_begin( mr )->stamp_ );
+
+                    // physical memory of the released block gets returned to OS
+                    EXPECT_EQ( static_cast< std::size_t >( purgeable_end - purgeable_begin ), mr.trim() );
+                    EXPECT_EQ( 0, accessor_type::garbage_begin( mr )->stamp_ );
+                    EXPECT_TRUE( is_purged( purgeable_begin, purgeable_end, page_size ) );
+                    EXPECT_EQ( 0, mr.trim() );
+
+                    // but the block stays available
+                    p = mr.allocate( sz, 1 );
+                    EXPECT_EQ( block_head, std::get< 0 >( test_heap< U >::get_piece_internal_fields( p ) ) );
+                    test_heap< U >::check_memory_piece( p, sz, 1 );
+                    mr.deallocate( p, sz, 1 );
+
+                    if constexpr ( policy_type::coalescing )
+                    {
+                        // given back pool area gets purged too
+                        mr.deallocate( fence, 1, 1 );
+                        EXPECT_LT( 0, mr.trim() );
+                        EXPECT_EQ( 0, accessor_type::garbage_size( mr ) );
+                        EXPECT_GE( pool_head->unallocated_, pool_head->dirty_ );
+                        EXPECT_TRUE( is_purged( accessor_type::ceil( pool_head->unallocated_, page_size ), accessor_type::floor( block_head + block_size, page_size ), page_size ) );
+                    }
+                    else
+                    {
+                        // pool stays untouched
+                        mr.deallocate( fence, 1, 1 );
+                        EXPECT_EQ( static_cast< std::size_t >( purgeable_end - purgeable_begin ), mr.trim() );
+                        EXPECT_GE( pool_head->unallocated_, pool_head->dirty_ );
+                    }
+                }
+                catch ( ... )
+                {
+                    GTEST_FAIL();
+                }
+            }
+
+            void operator()() const noexcept { run( T() ); }
+        };
+
+        TYPED_TEST( test_heap, trim )
+        {
+            trim_impl< TypeParam >()( );
+        }
+
+        //-----------------------------------------------------------------------------------------------------------------------------------------------------
+
+        template < typename T >
+        struct purge_decay_impl
+        {
+            static void run( ... ) noexcept {}
+
+            template < typename U >
+            static void run(
+                U&&,
+                decltype( U::is_purge_decay_test ) = U::is_purge_decay_test
+            ) noexcept
+            {
+                using policy_type = typename U::policy_type;
+                using memory_resource_type = typename test_heap< U >::memory_resource_type;
+                using accessor_type = typename test_heap< U >::accessor_type;
+                using pointer_type = typename accessor_type::pointer_type;
+
+                try
+                {
+                    memory_resource_type mr;
+                    std::size_t sz = 4 * accessor_type::system_page_size();
+                    auto p1 = mr.allocate( sz, 1 );
+                    auto p2 = mr.allocate( sz, 1 );
+                    auto block1 = std::get< 0 >( test_heap< U >::get_piece_internal_fields( p1 ) );
+                    auto block2 = std::get< 0 >( test_heap< U >::get_piece_internal_fields( p2 ) );
+
+                    // the 1st piece gets idle for a while
+                    mr.deallocate( p1, sz, 1 );
+                    std::this_thread::sleep_for( std::chrono::milliseconds( 10 * policy_type::purge_decay ) );
+
+                    // following deallocation purges it
+                    mr.deallocate( p2, sz, 1 );
+                    ASSERT_EQ( 2, accessor_type::garbage_size( mr ) );
+                    for ( auto it = accessor_type::garbage_begin( mr ); it != accessor_type::garbage_end( mr ); ++it )
+                    {
+                        if ( static_cast< pointer_type >( it ) == block1 )
+                        {
+                            EXPECT_EQ( 0, it->stamp_ );
+                        }
+                        else
+                        {
+                            EXPECT_EQ( block2, static_cast< pointer_type >( it ) );
+                            EXPECT_NE( 0, it->stamp_ );
+                        }
+                    }
+                }
+                catch ( ... )
+                {
+                    GTEST_FAIL();
+                }
+            }
+
+            void operator()() const noexcept { run( T() ); }
+        };
+
+        TYPED_TEST( test_heap, purge_decay )
+        {
+            purge_decay_impl< TypeParam >()( );
+        }
+
+        //-----------------------------------------------------------------------------------------------------------------------------------------------------
+
+        template < typename T >
+        struct reserve_impl
+        {
+            static void run( ... ) noexcept {}
+
+            template < typename U >
+            static void run(
+                U&&,
+                decltype( U::is_reserve_test ) = U::is_reserve_test
+            ) noexcept
+            {
+                using policy_type = typename U::policy_type;
+                using memory_resource_type = typename test_heap< U >::memory_resource_type;
+                using accessor_type = typename test_heap< U >::accessor_type;
+                using pointer_type = typename accessor_type::pointer_type;
+
+                try
+                {
+                    memory_resource_type mr;
+
+                    // waits till background thread fills the reserve up
+                    auto wait_for_reserve = [ &mr ]() {
+                        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds( 10 );
+                        while ( accessor_type::reserve_bytes( mr ) < policy_type::reserve_size && std::chrono::steady_clock::now() < deadline )
+                        {
+                            std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+                        }
+                        return accessor_type::reserve_bytes( mr ) >= policy_type::reserve_size;
+                    };
+
+                    ASSERT_TRUE( wait_for_reserve() );
+                    EXPECT_EQ( policy_type::reserve_size, accessor_type::reserve_bytes( mr ) );
+
+                    // take reserved blocks till the reserve drops below low watermark
+                    std::vector< pointer_type > reserved;
+                    for ( auto it = accessor_type::reserve_begin( mr ); it != accessor_type::reserve_end( mr ); ++it ) reserved.push_back( static_cast< pointer_type >( it ) );
+                    auto take = std::min( reserved.size(), ( policy_type::reserve_size - policy_type::reserve_low_watermark ) / accessor_type::pool_block_size + 1 );
+
+                    // each piece takes a whole pool block, the first one takes initial block
+                    std::size_t sz = accessor_type::pool_block_capacity - accessor_type::piece_internal_fields_size;
+                    std::vector< void* > pieces{ mr.allocate( sz, 1 ) };
+                    for ( std::size_t i = 0; i < take; ++i )
+                    {
+                        pieces.push_back( mr.allocate( sz, 1 ) );
+                        test_heap< U >::check_memory_piece( pieces.back(), sz, 1 );
+
+                        // the pool grows with pre-faulted reserved block
+                        auto pool_head = static_cast< pointer_type >( accessor_type::pool_begin( mr ) );
+                        EXPECT_EQ( reserved[ i ], pool_head );
+                        EXPECT_TRUE( is_resident( pool_head, pool_head + accessor_type::pool_block_size, accessor_type::system_page_size() ) );
+                    }
+
+                    // and the reserve gets replenished
+                    EXPECT_TRUE( wait_for_reserve() );
+
+                    for ( auto p : pieces ) mr.deallocate( p, sz, 1 );
+                }
+                catch ( ... )
+                {
+                    GTEST_FAIL();
+                }
+            }
+
+            void operator()() const noexcept { run( T() ); }
+        };
+
+        TYPED_TEST( test_heap, reserve )
+        {
+            reserve_impl< TypeParam >()( );
+        }
+
+        //-----------------------------------------------------------------------------------------------------------------------------------------------------
+
+        template < typename T >
+        struct statistics_impl
+        {
+            static void run( ... ) noexcept {}
+
+            template < typename U >
+            static void run(
+                U&&,
+                decltype( U::is_statistics_test ) = U::is_statistics_test
+            ) noexcept
+            {
+                using policy_type = typename U::policy_type;
+                using memory_resource_type = typename test_heap< U >::memory_resource_type;
+                using accessor_type = typename test_heap< U >::accessor_type;
+
+                try
+                {
+                    memory_resource_type mr;
+                    auto expect = [ &mr ]( event e, std::uint64_t value ) {
+                        EXPECT_EQ( policy_type::statistics ? value : 0, mr.get_statistics()[ e ] ) << "event #" << static_cast< int >( e );
+                    };
+
+                    // allocation on pool
+                    auto p1 = mr.allocate( 1, 1 );
+                    auto p2 = mr.allocate( 1, 1 );
+                    expect( event::pool_allocation, 2 );
+                    expect( event::garbage_allocation, 0 );
+
+                    // allocation on garbage or magazine
+                    mr.deallocate( p1, 1, 1 );
+                    p1 = mr.allocate( 1, 1 );
+                    expect( event::pool_allocation, 2 );
+                    expect( policy_type::magazine_size ? event::magazine_allocation : event::garbage_allocation, 1 );
+
+                    // large block
+                    std::size_t large_size = accessor_type::pool_block_capacity + 1;
+                    auto large = mr.allocate( large_size, 1 );
+                    mr.deallocate( large, large_size, 1 );
+                    expect( event::large_block_map, 1 );
+                    expect( event::large_block_unmap, 1 );
+
+                    // pool grow
+                    std::size_t half_size = accessor_type::pool_block_capacity / 2;
+                    auto h1 = mr.allocate( half_size, 1 );
+                    auto h2 = mr.allocate( half_size, 1 );
+                    expect( event::pool_grow, 2 );
+
+                    // counters of other threads are summed up
+                    std::thread( [ &mr ]() { mr.deallocate( mr.allocate( 1, 1 ), 1, 1 ); } ).join();
+                    expect( event::pool_allocation, 5 );
+
+                    // events of a thread only releasing pieces are counted without registering its state
+                    large = mr.allocate( large_size, 1 );
+                    auto state_count = accessor_type::thread_state_count( mr );
+                    std::thread( [ & ]() { mr.deallocate( large, large_size, 1 ); } ).join();
+                    expect( event::large_block_unmap, 2 );
+                    EXPECT_EQ( state_count, accessor_type::thread_state_count( mr ) );
+
+                    mr.deallocate( h1, half_size, 1 );
+                    mr.deallocate( h2, half_size, 1 );
+                    mr.deallocate( p1, 1, 1 );
+                    mr.deallocate( p2, 1, 1 );
+                }
+                catch ( ... )
+                {
+                    GTEST_FAIL();
+                }
+            }
+
+            void operator()() const noexcept { run( T() ); }
+        };
+
+        TYPED_TEST( test_heap, statistics )
+        {
+            statistics_impl< TypeParam >()( );
+        }
+
+        //-----------------------------------------------------------------------------------------------------------------------------------------------------
+
+        template < typename T >
+        struct snapshot_impl
+        {
+            static void run( ... ) noexcept {}
+
+            template < typename U >
+            static void run(
+                U&&,
+                decltype( U::is_snapshot_test ) = U::is_snapshot_test
+            ) noexcept
+            {
+                using memory_resource_type = typename test_heap< U >::memory_resource_type;
+                using accessor_type = typename test_heap< U >::accessor_type;
+                using pointer_type = typename accessor_type::pointer_type;
+
+                try
+                {
+                    memory_resource_type mr;
+
+                    // fresh resource
+                    auto empty = mr.get_snapshot();
+                    EXPECT_EQ( 1, empty.pool_block_count_ );
+                    EXPECT_EQ( accessor_type::pool_block_size, empty.pool_bytes_ );
+                    EXPECT_EQ( accessor_type::pool_block_capacity, empty.unallocated_bytes_ );
+                    EXPECT_EQ( accessor_type::pool_block_size, empty.committed_bytes_ );
+                    EXPECT_EQ( 0, empty.garbage_block_count_ );
+                    EXPECT_EQ( 0.0, empty.fragmentation_ );
+
+                    // allocate few pieces and release every second one
+                    std::vector< void* > pieces;
+                    for ( std::size_t i = 0; i < 8; ++i ) pieces.push_back( mr.allocate( 100, 1 ) );
+                    std::size_t garbage_bytes = 0;
+                    for ( std::size_t i = 0; i < pieces.size(); i += 2 )
+                    {
+                        garbage_bytes += std::get< 1 >( test_heap< U >::get_piece_internal_fields( pieces[ i ] ) );
+                        mr.deallocate( pieces[ i ], 100, 1 );
+                    }
+
+                    std::size_t large_size = accessor_type::pool_block_capacity + 1;
+                    auto large = mr.allocate( large_size, 1 );
+                    auto large_block_size = std::get< 1 >( test_heap< U >::get_piece_internal_fields( large ) );
+
+                    auto pool_head = accessor_type::pool_begin( mr );
+                    auto unallocated = static_cast< pointer_type >( pool_head ) + pool_head->size_ - pool_head->unallocated_;
+
+                    auto used = mr.get_snapshot();
+                    EXPECT_EQ( 1, used.pool_block_count_ );
+                    EXPECT_EQ( static_cast< std::size_t >( unallocated ), used.unallocated_bytes_ );
+                    EXPECT_EQ( used.unallocated_bytes_, used.largest_unallocated_ );
+                    EXPECT_EQ( 4, used.garbage_block_count_ );
+                    EXPECT_EQ( garbage_bytes, used.garbage_bytes_ );
+                    EXPECT_EQ( garbage_bytes / 4, used.largest_garbage_block_ );
+                    EXPECT_EQ( 1, used.large_block_count_ );
+                    EXPECT_EQ( static_cast< std::size_t >( large_block_size ), used.large_block_bytes_ );
+                    EXPECT_EQ( accessor_type::pool_block_size + large_block_size, used.committed_bytes_ );
+                    EXPECT_DOUBLE_EQ( 1.0 - double( used.unallocated_bytes_ ) / double( used.unallocated_bytes_ + garbage_bytes ), used.fragmentation_ );
+
+                    // garbage stays intact after the walk
+                    EXPECT_EQ( 4, accessor_type::garbage_size( mr ) );
+                    for ( auto it = accessor_type::garbage_begin( mr ); it != accessor_type::garbage_end( mr ); ++it )
+                    {
+                        EXPECT_EQ( 0, static_cast< pointer_type >( it->next_ ) & 1 );
+                    }
+
+                    // snapshots could be taken while other thread allocates
+                    std::atomic< bool > stop = false;
+                    std::thread worker( [ & ]() {
+                        std::vector< void* > own;
+                        for ( std::size_t i = 0; !stop; ++i )
+                        {
+                            own.push_back( mr.allocate( 16 + i % 512, 1 ) );
+                            if ( own.size() == 64 )
+                            {
+                                for ( auto p : own ) mr.deallocate( p, 1, 1 );
+                                own.clear();
+                            }
+                        }
+                        for ( auto p : own ) mr.deallocate( p, 1, 1 );
+                    } );
+                    for ( std::size_t i = 0; i < 1000; ++i )
+                    {
+                        auto concurrent = mr.get_snapshot();
+                        EXPECT_LE( concurrent.unallocated_bytes_ + concurrent.garbage_bytes_, concurrent.pool_bytes_ );
+                    }
+                    stop = true;
+                    worker.join();
+
+                    mr.deallocate( large, large_size, 1 );
+                    EXPECT_EQ( 0, mr.get_snapshot().large_block_bytes_ );
+                    for ( std::size_t i = 1; i < pieces.size(); i += 2 ) mr.deallocate( pieces[ i ], 100, 1 );
+                }
+                catch ( ... )
+                {
+                    GTEST_FAIL();
+                }
+            }
+
+            void operator()() const noexcept { run( T() ); }
+        };
+
+        TYPED_TEST( test_heap, snapshot )
+        {
+            snapshot_impl< TypeParam >()( );
+        }
+
+        //-----------------------------------------------------------------------------------------------------------------------------------------------------
+
+        template < typename T >
+        struct huge_pages_impl
+        {
+            static void run( ... ) noexcept {}
+
+            template < typename U >
+            static void run(
+                U&&,
+                decltype( U::is_huge_pages_test ) = U::is_huge_pages_test
+            ) noexcept
+            {
+                using policy_type = typename U::policy_type;
+                using memory_resource_type = typename test_heap< U >::memory_resource_type;
+                using accessor_type = typename test_heap< U >::accessor_type;
+                using pointer_type = typename accessor_type::pointer_type;
+
+                try
+                {
+                    auto huge = accessor_type::huge_page_size();
+                    if ( huge <= accessor_type::system_page_size() ) GTEST_SKIP();
+
+                    // pool blocks of huge page size or larger get rounded up to huge page size and aligned with huge page
+                    memory_resource_type mr;
+                    auto pool_head = static_cast< pointer_type >( accessor_type::pool_begin( mr ) );
+                    if ( static_cast< decltype( huge ) >( policy_type::block_size ) >= huge )
+                    {
+                        EXPECT_EQ( 0, accessor_type::pool_block_size % huge );
+                        EXPECT_EQ( 0, pool_head % huge );
+                    }
+                    else
+                    {
+                        EXPECT_EQ( accessor_type::ceil( policy_type::block_size, accessor_type::system_page_size() ), accessor_type::pool_block_size );
+                    }
+
+                    // same for large blocks
+                    std::size_t sz = huge + 1;
+                    auto p = mr.allocate( sz, 1 );
+                    test_heap< U >::check_memory_piece( p, sz, 1 );
+                    auto [ block_head, block_size ] = test_heap< U >::get_piece_internal_fields( p );
+                    EXPECT_EQ( 2 * huge, block_size );
+                    EXPECT_EQ( 0, block_head % huge );
+                    mr.deallocate( p, sz, 1 );
+
+                    // cached huge page block is not split at offset of other than huge page size
+                    if constexpr ( policy_type::large_cache_size > 0 )
+                    {
+                        std::size_t small_size = accessor_type::pool_block_capacity + 1;
+                        auto small = mr.allocate( small_size, 1 );
+                        EXPECT_EQ( 0, mr.get_statistics()[ event::large_cache_hit ] );
+                        EXPECT_EQ( static_cast< std::size_t >( 2 * huge ), mr.get_snapshot().large_cache_bytes_ );
+                        mr.deallocate( small, small_size, 1 );
+
+                        sz = huge - accessor_type::system_page_size();
+                        p = mr.allocate( sz, 1 );
+                        EXPECT_EQ( 1, mr.get_statistics()[ event::large_cache_hit ] );
+                        EXPECT_EQ( 0, accessor_type::floor( reinterpret_cast< pointer_type >( p ), accessor_type::system_page_size() ) % huge );
+                        mr.deallocate( p, sz, 1 );
+                    }
+                }
+                catch ( ... )
+                {
+                    GTEST_FAIL();
+                }
+            }
+
+            void operator()() const noexcept { run( T() ); }
+        };
+
+        TYPED_TEST( test_heap, huge_pages )
+        {
+            huge_pages_impl< TypeParam >()( );
+        }
+
+        //-----------------------------------------------------------------------------------------------------------------------------------------------------
+
+        template < typename T >
+        struct slab_impl
+        {
+            static void run( ... ) noexcept {}
+
+            template < typename U >
+            static void run(
+                U&&,
+                decltype( U::is_slab_test ) = U::is_slab_test
+            ) noexcept
+            {
+                using policy_type = typename U::policy_type;
+                using memory_resource_type = typename test_heap< U >::memory_resource_type;
+                using accessor_type = typename test_heap< U >::accessor_type;
+                using pointer_type = typename accessor_type::pointer_type;
+
+                try
+                {
+                    memory_resource_type mr;
+
+                    // slab range is reserved on first slab allocation
+                    EXPECT_EQ( 0, accessor_type::slab_begin( mr ) );
+                    auto in_slab = [ & ]( void* p ) {
+                        auto piece = reinterpret_cast< pointer_type >( p );
+                        return piece >= accessor_type::slab_begin( mr ) && piece < accessor_type::slab_end( mr );
+                    };
+
+                    // small pieces are packed without headers
+                    std::vector< void* > pieces;
+                    for ( std::size_t i = 0; i < 1000; ++i )
+                    {
+                        auto p = mr.allocate( 24, 1 );
+                        EXPECT_TRUE( in_slab( p ) );
+                        EXPECT_EQ( 24, accessor_type::slab_class_size( p ) );
+                        std::memset( p, 0xff, 24 );
+                        pieces.push_back( p );
+                    }
+                    EXPECT_EQ( reinterpret_cast< pointer_type >( pieces[ 0 ] ) + 24, reinterpret_cast< pointer_type >( pieces[ 1 ] ) );
+
+                    // the pieces take about 24 bytes each
+                    auto snapshot = mr.get_snapshot();
+                    EXPECT_LE( snapshot.slab_bytes_, ( 24 * 1000 / accessor_type::system_page_size() + 2 ) * accessor_type::system_page_size() );
+                    EXPECT_EQ( accessor_type::pool_block_size + snapshot.slab_bytes_, snapshot.committed_bytes_ );
+
+                    // released piece is reused first
+                    auto released = pieces[ 500 ];
+                    mr.deallocate( released, 24, 1 );
+                    EXPECT_EQ( released, mr.allocate( 20, 1 ) );
+
+                    // alignment rounds size class up
+                    auto aligned = mr.allocate( 24, 16 );
+                    EXPECT_TRUE( in_slab( aligned ) );
+                    EXPECT_EQ( 32, accessor_type::slab_class_size( aligned ) );
+                    EXPECT_EQ( 0, reinterpret_cast< pointer_type >( aligned ) % 16 );
+                    mr.deallocate( aligned, 24, 16 );
+
+                    // larger pieces and pieces of page alignment go to the pool
+                    auto large = mr.allocate( policy_type::slab_max_size + 1, 1 );
+                    EXPECT_FALSE( in_slab( large ) );
+                    test_heap< U >::check_memory_piece( large, policy_type::slab_max_size + 1, 1 );
+                    mr.deallocate( large, policy_type::slab_max_size + 1, 1 );
+                    auto page_aligned = mr.allocate( 8, accessor_type::system_page_size() );
+                    EXPECT_FALSE( in_slab( page_aligned ) );
+                    mr.deallocate( page_aligned, 8, accessor_type::system_page_size() );
+
+                    if constexpr ( policy_type::statistics )
+                    {
+                        EXPECT_EQ( 1002, mr.get_statistics()[ event::slab_allocation ] );
+                    }
+
+                    // concurrent allocations don't collide
+                    std::vector< void* > own[ 2 ];
+                    auto worker = [ & ]( std::size_t index ) {
+                        for ( std::size_t i = 0; i < 10000; ++i )
+                        {
+                            auto p = mr.allocate( 8 + i % 56, 1 );
+                            *reinterpret_cast< std::size_t* >( p ) = index;
+                            own[ index ].push_back( p );
+                            if ( i % 3 == 0 )
+                            {
+                                EXPECT_EQ( index, *reinterpret_cast< std::size_t* >( own[ index ].back() ) );
+                                mr.deallocate( own[ index ].back(), 1, 1 );
+                                own[ index ].pop_back();
+                            }
+                        }
+                    };
+                    std::thread t0( worker, 0 ), t1( worker, 1 );
+                    t0.join();
+                    t1.join();
+                    for ( std::size_t index = 0; index < 2; ++index )
+                    {
+                        for ( auto p : own[ index ] )
+                        {
+                            EXPECT_EQ( index, *reinterpret_cast< std::size_t* >( p ) );
+                            mr.deallocate( p, 1, 1 );
+                        }
+                    }
+
+                    for ( auto p : pieces ) mr.deallocate( p, 24, 1 );
+                }
+                catch ( ... )
+                {
+                    GTEST_FAIL();
+                }
+            }
+
+            void operator()() const noexcept { run( T() ); }
+        };
+
+        TYPED_TEST( test_heap, slab )
+        {
+            slab_impl< TypeParam >()( );
+        }
+
+        //-----------------------------------------------------------------------------------------------------------------------------------------------------
+
+        template < typename T >
+        struct slab_large_class_impl
+        {
+            static void run( ... ) noexcept {}
+
+            template < typename U >
+            static void run(
+                U&&,
+                decltype( U::is_slab_large_class_test ) = U::is_slab_large_class_test
+            ) noexcept
+            {
+                using policy_type = typename U::policy_type;
+                using memory_resource_type = typename test_heap< U >::memory_resource_type;
+                using accessor_type = typename test_heap< U >::accessor_type;
+                using pointer_type = typename accessor_type::pointer_type;
+
+                try
+                {
+                    memory_resource_type mr;
+
+                    // a run fits at least one piece of the largest class
+                    auto run_size = accessor_type::slab_run_size();
+                    EXPECT_GE( run_size, static_cast< decltype( run_size ) >( policy_type::slab_max_size ) );
+                    EXPECT_EQ( 0, run_size & ( run_size - 1 ) );
+
+                    // pieces of large classes stay within their runs and keep run headers intact
+                    std::vector< std::pair< void*, std::size_t > > pieces;
+                    for ( std::size_t size : { std::size_t( 6000 ), policy_type::slab_max_size, std::size_t( 4000 ), std::size_t( 24 ) } )
+                    {
+                        for ( std::size_t i = 0; i < 4; ++i )
+                        {
+                            auto p = mr.allocate( size, 8 );
+                            auto piece = reinterpret_cast< pointer_type >( p );
+                            auto run = accessor_type::floor( piece, run_size );
+                            EXPECT_GE( run, accessor_type::slab_begin( mr ) );
+                            EXPECT_LE( piece + static_cast< pointer_type >( size ), run + run_size );
+                            std::memset( p, 0xff, size );
+                            pieces.emplace_back( p, size );
+                        }
+                    }
+                    // slab range is aligned with run size, so run header is found by masking
+                    ASSERT_NE( 0, accessor_type::slab_begin( mr ) );
+                    EXPECT_EQ( 0, accessor_type::slab_begin( mr ) % run_size );
+                    for ( auto [ p, size ] : pieces )
+                    {
+                        EXPECT_EQ( accessor_type::ceil( static_cast< pointer_type >( size ), 8 ), accessor_type::slab_class_size( p ) );
+                        mr.deallocate( p, size, 8 );
+                    }
+
+                    // released pieces are reused
+                    auto p = mr.allocate( 6000, 8 );
+                    EXPECT_EQ( 6000, accessor_type::slab_class_size( p ) );
+                    mr.deallocate( p, 6000, 8 );
+                }
+                catch ( ... )
+                {
+                    GTEST_FAIL();
+                }
+            }
+
+            void operator()() const noexcept { run( T() ); }
+        };
+
+        TYPED_TEST( test_heap, slab_large_class )
+        {
+            slab_large_class_impl< TypeParam >()( );
+        }
+
+        //-----------------------------------------------------------------------------------------------------------------------------------------------------
+
+        template < typename T >
+        struct trusted_size_impl
+        {
+            static void run( ... ) noexcept {}
+
+            template < typename U >
+            static void run(
+                U&&,
+                decltype( U::is_trusted_size_test ) = U::is_trusted_size_test
+            ) noexcept
+            {
+                using memory_resource_type = typename test_heap< U >::memory_resource_type;
+                using accessor_type = typename test_heap< U >::accessor_type;
+                using pointer_type = typename accessor_type::pointer_type;
+
+                try
+                {
+                    EXPECT_EQ( 0, accessor_type::piece_internal_fields_size );
+                    auto piece_size = [ & ]( std::size_t bytes ) {
+                        return static_cast< std::size_t >( accessor_type::ceil( bytes + accessor_type::piece_trailer_size, accessor_type::granularity ) );
+                    };
+
+                    memory_resource_type mr;
+                    auto pool_head = static_cast< pointer_type >( accessor_type::pool_begin( mr ) );
+
+                    // pieces start right at unallocated area and follow each other without headers
+                    std::vector< void* > pieces;
+                    for ( std::size_t i = 0; i < 16; ++i )
+                    {
+                        pieces.push_back( mr.allocate( accessor_type::granularity, 1 ) );
+                        std::memset( pieces.back(), 0xcc, accessor_type::granularity );
+                    }
+                    EXPECT_EQ( pool_head + accessor_type::pool_block_header_size, reinterpret_cast< pointer_type >( pieces[ 0 ] ) );
+                    for ( std::size_t i = 1; i < pieces.size(); ++i )
+                    {
+                        EXPECT_EQ( piece_size( accessor_type::granularity ), reinterpret_cast< pointer_type >( pieces[ i ] ) - reinterpret_cast< pointer_type >( pieces[ i - 1 ] ) );
+                    }
+
+                    // released piece gets reused
+                    auto released = pieces[ 7 ];
+                    mr.deallocate( released, accessor_type::granularity, 1 );
+                    pieces[ 7 ] = mr.allocate( accessor_type::granularity, 1 );
+                    EXPECT_EQ( released, pieces[ 7 ] );
+
+                    // alignment gap is given to garbage
+                    std::size_t alignment = 4 * accessor_type::granularity;
+                    auto garbage_size = accessor_type::garbage_size( mr );
+                    auto aligned = mr.allocate( 1, alignment );
+                    EXPECT_EQ( 0, reinterpret_cast< pointer_type >( aligned ) % alignment );
+                    auto gap = reinterpret_cast< pointer_type >( aligned ) - reinterpret_cast< pointer_type >( pieces.back() ) - static_cast< pointer_type >( piece_size( accessor_type::granularity ) );
+                    EXPECT_EQ( garbage_size + ( gap ? 1 : 0 ), accessor_type::garbage_size( mr ) );
+                    mr.deallocate( aligned, 1, alignment );
+
+                    // large blocks keep only pointer to registry slot
+                    std::size_t large_size = accessor_type::pool_block_capacity + 1;
+                    auto large = mr.allocate( large_size, 1 );
+                    EXPECT_EQ( static_cast< pointer_type >( sizeof( pointer_type ) ), reinterpret_cast< pointer_type >( large ) % accessor_type::system_page_size() );
+                    std::memset( large, 0xcc, large_size );
+                    EXPECT_EQ( 1, mr.get_snapshot().large_block_count_ );
+                    mr.deallocate( large, large_size, 1 );
+                    EXPECT_EQ( 0, mr.get_snapshot().large_block_count_ );
+
+#ifndef NDEBUG
+                    // debug build catches wrong size
+                    EXPECT_DEATH( mr.deallocate( pieces[ 0 ], 4 * accessor_type::granularity, 1 ), "" );
+#endif
+
+                    for ( auto p : pieces ) mr.deallocate( p, accessor_type::granularity, 1 );
+                }
+                catch ( ... )
+                {
+                    GTEST_FAIL();
+                }
+            }
+
+            void operator()() const noexcept { run( T() ); }
+        };
+
+        TYPED_TEST( test_heap, trusted_size )
+        {
+            trusted_size_impl< TypeParam >()( );
+        }
+
+        //-----------------------------------------------------------------------------------------------------------------------------------------------------
+
+        template < typename T >
+        struct bulk_impl
+        {
+            static void run( ... ) noexcept {}
+
+            template < typename U >
+            static void run(
+                U&&,
+                decltype( U::is_bulk_test ) = U::is_bulk_test
+            ) noexcept
+            {
+                using memory_resource_type = typename test_heap< U >::memory_resource_type;
+                using accessor_type = typename test_heap< U >::accessor_type;
+                using pointer_type = typename accessor_type::pointer_type;
+
+                try
+                {
+                    constexpr std::size_t n = 100, bytes = 100, alignment = 8;
+                    auto stride = static_cast< std::size_t >( accessor_type::ceil( accessor_type::ceil( accessor_type::piece_internal_fields_size, alignment ) + bytes + accessor_type::piece_trailer_size, accessor_type::granularity ) );
+
+                    memory_resource_type mr;
+                    EXPECT_THROW( mr.allocate_bulk( n, 0, alignment, nullptr ), std::invalid_argument );
+
+                    // the whole batch is taken from pool at once, pieces follow each other
+                    std::vector< void* > pieces( n );
+                    mr.allocate_bulk( n, bytes, alignment, pieces.data() );
+                    for ( std::size_t i = 0; i < n; ++i )
+                    {
+                        EXPECT_EQ( 0, reinterpret_cast< pointer_type >( pieces[ i ] ) % alignment );
+                        if ( i )
+                        {
+                            EXPECT_EQ( stride, reinterpret_cast< pointer_type >( pieces[ i ] ) - reinterpret_cast< pointer_type >( pieces[ i - 1 ] ) );
+                        }
+                        std::memset( pieces[ i ], 0xcc, bytes );
+                    }
+                    EXPECT_EQ( 1, mr.get_statistics()[ event::pool_allocation ] );
+
+                    // the batch goes to garbage by single CAS and could be released piece by piece as well
+                    auto single = pieces.back();
+                    mr.deallocate_bulk( pieces.data(), n - 1, bytes, alignment );
+                    EXPECT_EQ( n - 1, accessor_type::garbage_size( mr ) );
+                    mr.deallocate( single, bytes, alignment );
+                    EXPECT_EQ( n, accessor_type::garbage_size( mr ) );
+                    EXPECT_EQ( 0, mr.get_statistics()[ event::garbage_cas_retry ] );
+
+                    // a batch gets carved from released block
+                    auto big = mr.allocate( n * stride, 1 );
+                    auto big_block = reinterpret_cast< pointer_type >( big ) - accessor_type::piece_internal_fields_size;
+                    mr.deallocate( big, n * stride, 1 );
+                    auto garbage_allocations = mr.get_statistics()[ event::garbage_allocation ];
+                    mr.allocate_bulk( n / 2, bytes, alignment, pieces.data() );
+                    EXPECT_EQ( garbage_allocations + 1, mr.get_statistics()[ event::garbage_allocation ] );
+                    EXPECT_EQ( big_block + accessor_type::ceil( accessor_type::piece_internal_fields_size, alignment ), reinterpret_cast< pointer_type >( pieces[ 0 ] ) );
+                    mr.deallocate_bulk( pieces.data(), n / 2, bytes, alignment );
+
+                    // batch exceeding pool block is split
+                    std::size_t many = 2 * accessor_type::pool_block_capacity / stride + 1;
+                    std::vector< void* > more( many );
+                    mr.allocate_bulk( many, bytes, alignment, more.data() );
+                    std::sort( more.begin(), more.end() );
+                    EXPECT_EQ( more.end(), std::adjacent_find( more.begin(), more.end(), [ & ]( void* lhs, void* rhs ) {
+                        return reinterpret_cast< pointer_type >( rhs ) - reinterpret_cast< pointer_type >( lhs ) < static_cast< pointer_type >( stride ); } ) );
+                    mr.deallocate_bulk( more.data(), many, bytes, alignment );
+
+                    // small and large pieces are allocated one by one
+                    void* small[ 4 ];
+                    mr.allocate_bulk( 4, 8, 8, small );
+                    for ( auto p : small ) std::memset( p, 0xcc, 8 );
+                    mr.deallocate_bulk( small, 4, 8, 8 );
+
+                    std::size_t large_size = accessor_type::pool_block_capacity + 1;
+                    void* large[ 2 ];
+                    mr.allocate_bulk( 2, large_size, 1, large );
+                    EXPECT_EQ( 2, mr.get_snapshot().large_block_count_ );
+                    mr.deallocate_bulk( large, 2, large_size, 1 );
+                    EXPECT_EQ( 0, mr.get_snapshot().large_block_count_ );
+                }
+                catch ( ... )
+                {
+                    GTEST_FAIL();
+                }
+            }
+
+            void operator()() const noexcept { run( T() ); }
+        };
+
+        TYPED_TEST( test_heap, bulk )
+        {
+            bulk_impl< TypeParam >()( );
+        }
+
+        //-----------------------------------------------------------------------------------------------------------------------------------------------------
+
+        template < typename T >
+        struct release_impl
+        {
+            static void run( ... ) noexcept {}
+
+            template < typename U >
+            static void run(
+                U&&,
+                decltype( U::is_release_test ) = U::is_release_test
+            ) noexcept
+            {
+                using policy_type = typename U::policy_type;
+                using memory_resource_type = typename test_heap< U >::memory_resource_type;
+                using accessor_type = typename test_heap< U >::accessor_type;
+                using pointer_type = typename accessor_type::pointer_type;
+
+                try
+                {
+                    memory_resource_type mr;
+                    EXPECT_TRUE( mr.allocate( 100, 1 ) );
+
+                    // fill few pool blocks, release some pieces to garbage and magazines
+                    std::vector< void* > pieces;
+                    while ( accessor_type::pool_size( mr ) < 3 ) pieces.push_back( mr.allocate( 1000, 8 ) );
+                    for ( std::size_t i = 0; i < pieces.size(); i += 2 ) mr.deallocate( pieces[ i ], 1000, 8 );
+                    auto small = mr.allocate( 8, 8 );
+                    EXPECT_TRUE( small );
+                    std::size_t large_size = accessor_type::pool_block_capacity + 1;
+                    EXPECT_TRUE( mr.allocate( large_size, 1 ) );
+                    EXPECT_TRUE( mr.allocate( large_size, 1 ) );
+
+                    std::vector< pointer_type > pool_blocks;
+                    for ( auto it = accessor_type::pool_begin( mr ); it != accessor_type::pool_end( mr ); ++it ) pool_blocks.push_back( static_cast< pointer_type >( it ) );
+
+                    // everything is given back, pool blocks are kept
+                    mr.release();
+                    auto snapshot = mr.get_snapshot();
+                    EXPECT_EQ( 3, snapshot.pool_block_count_ );
+                    EXPECT_EQ( 3 * accessor_type::pool_block_capacity, snapshot.unallocated_bytes_ );
+                    EXPECT_EQ( 0, snapshot.garbage_block_count_ );
+                    EXPECT_EQ( 0, snapshot.large_block_count_ );
+                    EXPECT_EQ( 0, snapshot.large_block_bytes_ );
+                    EXPECT_EQ( 0, snapshot.slab_bytes_ );
+                    if constexpr ( policy_type::magazine_size > 0 )
+                    {
+                        EXPECT_EQ( 0, accessor_type::magazine_size( mr ) );
+                    }
+
+                    // the same memory serves following allocations
+                    EXPECT_EQ( pool_blocks[ 0 ] + accessor_type::pool_block_header_size, reinterpret_cast< pointer_type >( mr.allocate( 1000, 8 ) ) - accessor_type::piece_internal_fields_size );
+                    if constexpr ( policy_type::slab_max_size > 0 )
+                    {
+                        EXPECT_EQ( small, mr.allocate( 8, 8 ) );
+                    }
+
+                    // slots of released large blocks are reused by the registry
+                    std::vector< void* > large_blocks;
+                    for ( std::size_t i = 0; i < 100; ++i ) large_blocks.push_back( mr.allocate( large_size, 1 ) );
+                    auto registry_size = accessor_type::large_registry_size( mr );
+                    EXPECT_LE( 2, registry_size );
+                    for ( auto large : large_blocks ) mr.deallocate( large, large_size, 1 );
+                    for ( auto& large : large_blocks ) large = mr.allocate( large_size, 1 );
+                    mr.release();
+                    for ( auto& large : large_blocks ) large = mr.allocate( large_size, 1 );
+                    EXPECT_EQ( registry_size, accessor_type::large_registry_size( mr ) );
+                    EXPECT_EQ( 100, mr.get_snapshot().large_block_count_ );
+                    for ( auto large : large_blocks ) mr.deallocate( large, large_size, 1 );
+                    EXPECT_EQ( 0, mr.get_snapshot().large_block_count_ );
+
+                    // the most recent block is retained only
+                    mr.release( accessor_type::pool_block_size );
+                    EXPECT_EQ( 1, accessor_type::pool_size( mr ) );
+                    EXPECT_EQ( pool_blocks[ 0 ], static_cast< pointer_type >( accessor_type::pool_begin( mr ) ) );
+
+                    // and nothing at all
+                    mr.release( 0 );
+                    EXPECT_EQ( 0, accessor_type::pool_size( mr ) );
+                    auto p = mr.allocate( 100, 1 );
+                    EXPECT_TRUE( p );
+                    EXPECT_EQ( 1, accessor_type::pool_size( mr ) );
+                    mr.deallocate( p, 100, 1 );
+                }
+                catch ( ... )
+                {
+                    GTEST_FAIL();
+                }
+            }
+
+            void operator()() const noexcept { run( T() ); }
+        };
+
+        TYPED_TEST( test_heap, release )
+        {
+            release_impl< TypeParam >()( );
+        }
+
+        //-----------------------------------------------------------------------------------------------------------------------------------------------------
+
+        template < typename T >
+        struct rewind_impl
+        {
+            static void run( ... ) noexcept {}
+
+            template < typename U >
+            static void run(
+                U&&,
+                decltype( U::is_rewind_test ) = U::is_rewind_test
+            ) noexcept
+            {
+                using policy_type = typename U::policy_type;
+                using memory_resource_type = typename test_heap< U >::memory_resource_type;
+                using accessor_type = typename test_heap< U >::accessor_type;
+                using pointer_type = typename accessor_type::pointer_type;
+
+                try
+                {
+                    memory_resource_type mr;
+                    auto before = mr.allocate( 100, 1 );
+                    auto mark = mr.checkpoint();
+                    auto mark_block = static_cast< pointer_type >( accessor_type::pool_begin( mr ) );
+                    EXPECT_EQ( mark_block, mark.pool_block_ );
+                    EXPECT_EQ( accessor_type::pool_begin( mr )->unallocated_, mark.unallocated_ );
+
+                    for ( std::size_t round = 0; round < 2; ++round )
+                    {
+                        // scratch phase spans few pool blocks and releases some pieces
+                        std::vector< void* > scratch;
+                        while ( accessor_type::pool_size( mr ) < 3 ) scratch.push_back( mr.allocate( 100, 1 ) );
+                        for ( std::size_t i = 0; i < scratch.size(); i += 3 ) mr.deallocate( scratch[ i ], 100, 1 );
+
+                        // everything carved after the checkpoint is gone
+                        mr.rewind( mark );
+                        EXPECT_EQ( 3, accessor_type::pool_size( mr ) );
+                        for ( auto it = accessor_type::pool_begin( mr ); it != accessor_type::pool_end( mr ); ++it )
+                        {
+                            auto block = static_cast< pointer_type >( it );
+                            EXPECT_EQ( block == mark_block ? mark.unallocated_ : block + accessor_type::pool_block_header_size, it->unallocated_ );
+                        }
+                        EXPECT_EQ( 0, accessor_type::garbage_size( mr ) );
+                        if constexpr ( policy_type::magazine_size > 0 )
+                        {
+                            EXPECT_EQ( 0, accessor_type::magazine_size( mr ) );
+                        }
+
+                        // and available again
+                        auto head = static_cast< pointer_type >( accessor_type::pool_begin( mr ) );
+                        auto p = mr.allocate( 100, 1 );
+                        EXPECT_EQ( head + accessor_type::pool_block_header_size + accessor_type::piece_internal_fields_size, reinterpret_cast< pointer_type >( p ) );
+                        mr.rewind( mark );
+                    }
+
+                    // released block merged across the checkpoint gets cut
+                    if constexpr ( policy_type::coalescing )
+                    {
+                        mr.release();
+                        auto first = mr.allocate( 100, 1 );
+                        auto first_size = std::get< 1 >( test_heap< U >::get_piece_internal_fields( first ) );
+                        auto scratch_mark = mr.checkpoint();
+                        auto second = mr.allocate( 100, 1 );
+                        EXPECT_TRUE( mr.allocate( 100, 1 ) );
+                        mr.deallocate( first, 100, 1 );
+                        mr.deallocate( second, 100, 1 );
+                        EXPECT_TRUE( mr.coalesce() );
+                        EXPECT_EQ( 1, accessor_type::garbage_size( mr ) );
+                        mr.rewind( scratch_mark );
+                        ASSERT_EQ( 1, accessor_type::garbage_size( mr ) );
+                        EXPECT_EQ( first_size, accessor_type::garbage_begin( mr )->size_ );
+                    }
+                    else
+                    {
+                        mr.deallocate( before, 100, 1 );
+                        EXPECT_EQ( 1, accessor_type::garbage_size( mr ) + accessor_type::magazine_size( mr ) );
+                    }
+                }
+                catch ( ... )
+                {
+                    GTEST_FAIL();
+                }
+            }
+
+            void operator()() const noexcept { run( T() ); }
+        };
+
+        TYPED_TEST( test_heap, rewind )
+        {
+            rewind_impl< TypeParam >()( );
+        }
+
+        //-----------------------------------------------------------------------------------------------------------------------------------------------------
+
+        template < typename T >
+        struct large_cache_impl
+        {
+            static void run( ... ) noexcept {}
+
+            template < typename U >
+            static void run(
+                U&&,
+                decltype( U::is_large_cache_test ) = U::is_large_cache_test
+            ) noexcept
+            {
+                using policy_type = typename U::policy_type;
+                using memory_resource_type = typename test_heap< U >::memory_resource_type;
+
+                try
+                {
+                    memory_resource_type mr;
+                    std::size_t size = 4 * policy_type::block_size;
+
+                    // released block stays mapped
+                    auto p = mr.allocate( size, 1 );
+                    auto [ block, block_size ] = test_heap< U >::get_piece_internal_fields( p );
+                    mr.deallocate( p, size, 1 );
+                    auto snapshot = mr.get_snapshot();
+                    EXPECT_EQ( 0, snapshot.large_block_count_ );
+                    EXPECT_EQ( static_cast< std::size_t >( block_size ), snapshot.large_cache_bytes_ );
+                    EXPECT_EQ( 0, mr.get_statistics()[ event::large_block_unmap ] );
+
+                    // and gets reused
+                    p = mr.allocate( size, 1 );
+                    test_heap< U >::check_memory_piece( p, size, 1 );
+                    EXPECT_EQ( block, std::get< 0 >( test_heap< U >::get_piece_internal_fields( p ) ) );
+                    EXPECT_EQ( 1, mr.get_statistics()[ event::large_cache_hit ] );
+                    EXPECT_EQ( 1, mr.get_statistics()[ event::large_block_map ] );
+                    EXPECT_EQ( 0, mr.get_snapshot().large_cache_bytes_ );
+                    mr.deallocate( p, size, 1 );
+
+#ifndef _WIN32
+                    // smaller request splits cached block
+                    p = mr.allocate( size / 2, 1 );
+                    auto [ split, split_size ] = test_heap< U >::get_piece_internal_fields( p );
+                    EXPECT_EQ( block, split );
+                    EXPECT_EQ( static_cast< std::size_t >( block_size - split_size ), mr.get_snapshot().large_cache_bytes_ );
+                    mr.deallocate( p, size / 2, 1 );
+                    EXPECT_EQ( static_cast< std::size_t >( block_size ), mr.get_snapshot().large_cache_bytes_ );
+#endif
+
+                    // cache does not exceed its limit
+                    std::size_t huge_size = policy_type::large_cache_size * 3 / 4;
+                    auto h1 = mr.allocate( huge_size, 1 );
+                    auto h2 = mr.allocate( huge_size, 1 );
+                    mr.deallocate( h1, huge_size, 1 );
+                    mr.deallocate( h2, huge_size, 1 );
+                    EXPECT_LE( mr.get_snapshot().large_cache_bytes_, policy_type::large_cache_size );
+                    EXPECT_LE( 1, mr.get_statistics()[ event::large_block_unmap ] );
+
+                    // idle blocks get unmapped
+                    if constexpr ( policy_type::large_cache_decay > 0 )
+                    {
+                        std::this_thread::sleep_for( std::chrono::milliseconds( 2 * policy_type::large_cache_decay ) );
+                        p = mr.allocate( size, 1 );
+                        auto q = mr.allocate( size, 1 );
+                        mr.deallocate( p, size, 1 );
+                        std::this_thread::sleep_for( std::chrono::milliseconds( 2 * policy_type::large_cache_decay ) );
+                        mr.deallocate( q, size, 1 );
+                        EXPECT_EQ( static_cast< std::size_t >( block_size ), mr.get_snapshot().large_cache_bytes_ );
+                    }
+
+                    // trim unmaps everything
+                    EXPECT_LE( static_cast< std::size_t >( block_size ), mr.trim() );
+                    EXPECT_EQ( 0, mr.get_snapshot().large_cache_bytes_ );
+                }
+                catch ( ... )
+                {
+                    GTEST_FAIL();
+                }
+            }
+
+            void operator()() const noexcept { run( T() ); }
+        };
+
+        TYPED_TEST( test_heap, large_cache )
+        {
+            large_cache_impl< TypeParam >()( );
+        }
+
+        //-----------------------------------------------------------------------------------------------------------------------------------------------------
+
+        template < typename T >
+        struct reallocate_impl
+        {
+            static void run( ... ) noexcept {}
+
+            template < typename U >
+            static void run(
+                U&&,
+                decltype( U::is_reallocate_test ) = U::is_reallocate_test
+            ) noexcept
+            {
+                using policy_type = typename U::policy_type;
+                using memory_resource_type = typename test_heap< U >::memory_resource_type;
+                using accessor_type = typename test_heap< U >::accessor_type;
+                using pointer_type = typename accessor_type::pointer_type;
+
+                auto fill = []( void* p, std::size_t size ) {
+                    for ( std::size_t i = 0; i < size; ++i ) reinterpret_cast< unsigned char* >( p )[ i ] = static_cast< unsigned char >( i );
+                };
+                auto check = []( void* p, std::size_t size ) {
+                    for ( std::size_t i = 0; i < size; ++i )
+                    {
+                        if ( reinterpret_cast< unsigned char* >( p )[ i ] != static_cast< unsigned char >( i ) ) return false;
+                    }
+                    return true;
+                };
+
+                try
+                {
+                    memory_resource_type mr;
+                    auto unallocated = [ & ]() { return static_cast< pointer_type >( accessor_type::pool_begin( mr )->unallocated_ ); };
+
+                    // the last piece grows and shrinks in place
+                    auto p = mr.allocate( 100, 8 );
+                    fill( p, 100 );
+                    EXPECT_TRUE( mr.try_expand( p, 100, 1000, 8 ) );
+                    EXPECT_EQ( accessor_type::ceil( reinterpret_cast< pointer_type >( p ) + 1000 + accessor_type::piece_trailer_size, accessor_type::granularity ), unallocated() );
+                    EXPECT_TRUE( check( p, 100 ) );
+                    EXPECT_TRUE( mr.try_expand( p, 1000, 200, 8 ) );
+                    EXPECT_EQ( accessor_type::ceil( reinterpret_cast< pointer_type >( p ) + 200 + accessor_type::piece_trailer_size, accessor_type::granularity ), unallocated() );
+
+                    // the piece followed by another one cannot grow, but can shrink
+                    auto q = mr.allocate( 100, 8 );
+                    EXPECT_FALSE( mr.try_expand( p, 200, 1000, 8 ) );
+                    EXPECT_TRUE( mr.try_expand( p, 200, 10, 8 ) );
+                    EXPECT_EQ( 1, accessor_type::garbage_size( mr ) );
+
+                    // so it gets moved
+                    fill( p, 10 );
+                    auto moved = mr.reallocate( p, 10, 1000, 8 );
+                    EXPECT_NE( p, moved );
+                    EXPECT_TRUE( check( moved, 10 ) );
+                    EXPECT_LT( reinterpret_cast< pointer_type >( q ), reinterpret_cast< pointer_type >( moved ) );
+                    mr.deallocate( q, 100, 8 );
+
+                    // piece does not turn into large block
+                    std::size_t large_size = accessor_type::pool_block_capacity + 1;
+                    EXPECT_FALSE( mr.try_expand( moved, 1000, large_size, 8 ) );
+                    auto large = mr.reallocate( moved, 1000, large_size, 8 );
+                    EXPECT_TRUE( check( large, 10 ) );
+                    EXPECT_EQ( 1, mr.get_snapshot().large_block_count_ );
+
+                    // large block gets remapped without copying
+                    fill( large, large_size );
+                    auto larger_size = 16 * large_size;
+                    auto larger = mr.reallocate( large, large_size, larger_size, 8 );
+                    EXPECT_TRUE( check( larger, large_size ) );
+                    fill( larger, larger_size );
+                    EXPECT_EQ( 1, mr.get_snapshot().large_block_count_ );
+#ifdef __linux__
+                    EXPECT_EQ( 1, mr.get_statistics()[ event::large_block_remap ] );
+                    EXPECT_LE( static_cast< std::size_t >( larger_size ), mr.get_snapshot().large_block_bytes_ );
+                    EXPECT_TRUE( mr.try_expand( larger, larger_size, large_size, 8 ) );
+                    EXPECT_TRUE( check( larger, large_size ) );
+                    larger_size = large_size;
+#endif
+                    mr.deallocate( larger, larger_size, 8 );
+                    EXPECT_EQ( 0, mr.get_snapshot().large_block_count_ );
+                    EXPECT_EQ( 0, mr.get_snapshot().large_block_bytes_ );
+
+                    // slab piece stays within its size class
+                    if constexpr ( policy_type::slab_max_size > 0 )
+                    {
+                        auto small = mr.allocate( 20, 8 );
+                        EXPECT_TRUE( mr.try_expand( small, 20, 24, 8 ) );
+                        EXPECT_FALSE( mr.try_expand( small, 24, 25, 8 ) );
+                        fill( small, 24 );
+                        auto grown = mr.reallocate( small, 24, 100, 8 );
+                        EXPECT_TRUE( check( grown, 24 ) );
+                        mr.deallocate( grown, 100, 8 );
+                    }
+                }
+                catch ( ... )
+                {
+                    GTEST_FAIL();
+                }
+            }
+
+            void operator()() const noexcept { run( T() ); }
+        };
+
+        TYPED_TEST( test_heap, reallocate )
+        {
+            reallocate_impl< TypeParam >()( );
+        }
+
+        //-----------------------------------------------------------------------------------------------------------------------------------------------------
+
+        template < typename T >
+        struct allocate_at_least_impl
+        {
+            static void run( ... ) noexcept {}
+
+            template < typename U >
+            static void run(
+                U&&,
+                decltype( U::is_allocate_at_least_test ) = U::is_allocate_at_least_test
+            ) noexcept
+            {
+                using policy_type = typename U::policy_type;
+                using memory_resource_type = typename test_heap< U >::memory_resource_type;
+                using accessor_type = typename test_heap< U >::accessor_type;
+                using pointer_type = typename accessor_type::pointer_type;
+
+                try
+                {
+                    memory_resource_type mr;
+
+                    // the slack up to the granularity is usable
+                    auto offset = static_cast< std::size_t >( accessor_type::ceil( accessor_type::piece_internal_fields_size, 8 ) );
+                    auto [ p, count ] = mr.allocate_at_least( 100, 8 );
+                    EXPECT_EQ( accessor_type::ceil( offset + 100 + accessor_type::piece_trailer_size, accessor_type::granularity ) - offset - accessor_type::piece_trailer_size, count );
+                    std::memset( p, 0xcc, count );
+                    auto next = mr.allocate( 100, 8 );
+                    EXPECT_LE( reinterpret_cast< pointer_type >( p ) + static_cast< pointer_type >( count ), reinterpret_cast< pointer_type >( next ) );
+                    mr.deallocate( next, 100, 8 );
+
+                    // the piece could be given back with any size up to usable one
+                    mr.deallocate( p, count, 8 );
+                    auto again = mr.allocate_at_least( 100, 8 );
+                    EXPECT_EQ( p, again.ptr_ );
+                    EXPECT_EQ( count, again.count_ );
+                    mr.deallocate( again.ptr_, 100, 8 );
+
+                    // slab pieces report their size class
+                    if constexpr ( policy_type::slab_max_size > 0 )
+                    {
+                        auto small = mr.allocate_at_least( 20, 8 );
+                        EXPECT_EQ( 24, small.count_ );
+                        mr.deallocate( small.ptr_, small.count_, 8 );
+                    }
+
+                    // large block reports its pages
+                    std::size_t large_size = accessor_type::pool_block_capacity + 1;
+                    auto large = mr.allocate_at_least( large_size, 1 );
+                    EXPECT_EQ( 0, ( reinterpret_cast< pointer_type >( large.ptr_ ) + static_cast< pointer_type >( large.count_ + accessor_type::piece_trailer_size ) ) % accessor_type::system_page_size() );
+                    EXPECT_LE( large_size, large.count_ );
+                    std::memset( large.ptr_, 0xcc, large.count_ );
+                    mr.deallocate( large.ptr_, large.count_, 1 );
+                    EXPECT_EQ( 0, mr.get_snapshot().large_block_count_ );
+
+                    // polymorphic allocator helper
+                    std::pmr::polymorphic_allocator< std::uint32_t > allocator( &mr );
+                    auto [ objects, n ] = bits::allocate_at_least( allocator, 10 );
+                    EXPECT_LE( 10, n );
+                    for ( std::size_t i = 0; i < n; ++i ) objects[ i ] = static_cast< std::uint32_t >( i );
+                    allocator.deallocate( objects, n );
+
+                    // the helper works for a resource of any policy
+                    lock_free_memory_resource< set_granularity< policy_type, 0x100 > > coarse;
+                    std::pmr::polymorphic_allocator< std::uint32_t > coarse_allocator( &coarse );
+                    auto [ coarse_objects, coarse_n ] = bits::allocate_at_least( coarse_allocator, 100 );
+                    EXPECT_LT( 100, coarse_n );
+                    coarse_allocator.deallocate( coarse_objects, coarse_n );
+
+                    std::pmr::polymorphic_allocator< std::uint32_t > other( std::pmr::new_delete_resource() );
+                    auto [ other_objects, other_n ] = bits::allocate_at_least( other, 10 );
+                    EXPECT_EQ( 10, other_n );
+                    other.deallocate( other_objects, other_n );
+                }
+                catch ( ... )
+                {
+                    GTEST_FAIL();
+                }
+            }
+
+            void operator()() const noexcept { run( T() ); }
+        };
+
+        TYPED_TEST( test_heap, allocate_at_least )
+        {
+            allocate_at_least_impl< TypeParam >()( );
+        }
+
+        //-----------------------------------------------------------------------------------------------------------------------------------------------------
+
+        template < typename T >
+        struct allocate_zeroed_impl
+        {
+            static void run( ... ) noexcept {}
+
+            template < typename U >
+            static void run(
+                U&&,
+                decltype( U::is_allocate_zeroed_test ) = U::is_allocate_zeroed_test
+            ) noexcept
+            {
+                using policy_type = typename U::policy_type;
+                using memory_resource_type = typename test_heap< U >::memory_resource_type;
+                using accessor_type = typename test_heap< U >::accessor_type;
+                using pointer_type = typename accessor_type::pointer_type;
+
+                auto is_zeroed = []( void* p, std::size_t bytes ) {
+                    auto begin = reinterpret_cast< const unsigned char* >( p );
+                    return std::all_of( begin, begin + bytes, []( unsigned char c ) { return c == 0; } );
+                };
+
+                try
+                {
+                    memory_resource_type mr;
+                    constexpr std::size_t sz = 1000;
+                    auto page_size = accessor_type::system_page_size();
+
+                    // fresh pool area comes zero-filled and untouched
+                    std::size_t table_size = 4 * page_size;
+                    auto table = mr.allocate_zeroed( table_size, 8 );
+                    auto table_begin = accessor_type::ceil( reinterpret_cast< pointer_type >( table ) + 1, page_size );
+                    auto table_end = accessor_type::floor( reinterpret_cast< pointer_type >( table ) + static_cast< pointer_type >( table_size ), page_size );
+                    EXPECT_TRUE( is_purged( table_begin, table_end, page_size ) );
+                    EXPECT_TRUE( is_zeroed( table, table_size ) );
+
+                    auto p = mr.allocate_zeroed( sz, 8 );
+                    EXPECT_TRUE( is_zeroed( p, sz ) );
+                    std::memset( p, 0xcc, sz );
+
+                    // the piece given back to the pool and reallocated from there gets cleared
+                    mr.deallocate( p, sz, 8 );
+                    auto q = mr.allocate_zeroed( sz, 8 );
+                    EXPECT_EQ( p, q );
+                    EXPECT_TRUE( is_zeroed( q, sz ) );
+                    std::memset( q, 0xcc, sz );
+
+                    // the piece reused from garbage gets cleared as well
+                    auto fence = mr.allocate( 1, 1 );
+                    mr.deallocate( q, sz, 8 );
+                    auto r = mr.allocate_zeroed( sz, 8 );
+                    EXPECT_EQ( q, r );
+                    EXPECT_TRUE( is_zeroed( r, sz ) );
+                    mr.deallocate( r, sz, 8 );
+                    mr.deallocate( fence, 1, 1 );
+
+                    // rewound area gets cleared
+                    auto m = mr.checkpoint();
+                    auto s = mr.allocate( sz, 8 );
+                    std::memset( s, 0xcc, sz );
+                    mr.rewind( m );
+                    s = mr.allocate_zeroed( sz, 8 );
+                    EXPECT_TRUE( is_zeroed( s, sz ) );
+                    mr.deallocate( s, sz, 8 );
+
+                    // large block is zero-filled whether it is freshly mapped or cached
+                    std::size_t large_size = accessor_type::pool_block_capacity + 1;
+                    for ( auto i = 0; i < 2; ++i )
+                    {
+                        auto large = mr.allocate_zeroed( large_size, 8 );
+                        if ( i == 0 )
+                        {
+                            // freshly mapped pages have not been touched
+                            auto begin = accessor_type::ceil( reinterpret_cast< pointer_type >( large ) + 1, page_size );
+                            auto end = accessor_type::floor( reinterpret_cast< pointer_type >( large ) + static_cast< pointer_type >( large_size ), page_size );
+                            EXPECT_TRUE( is_purged( begin, end, page_size ) );
+                        }
+                        EXPECT_TRUE( is_zeroed( large, large_size ) );
+                        std::memset( large, 0xcc, large_size );
+                        mr.deallocate( large, large_size, 8 );
+                    }
+                    if constexpr ( policy_type::large_cache_size > 0 )
+                    {
+                        EXPECT_EQ( 1, mr.get_statistics()[ event::large_cache_hit ] );
+                    }
+                    mr.deallocate( table, table_size, 8 );
+                }
+                catch ( ... )
+                {
+                    GTEST_FAIL();
+                }
+            }
+
+            void operator()() const noexcept { run( T() ); }
+        };
+
+        TYPED_TEST( test_heap, allocate_zeroed )
+        {
+            allocate_zeroed_impl< TypeParam >()( );
+        }
+
+        //-----------------------------------------------------------------------------------------------------------------------------------------------------
+
+        template < typename T >
+        struct over_alignment_impl
+        {
+            static void run( ... ) noexcept {}
+
+            template < typename U >
+            static void run(
+                U&&,
+                decltype( U::is_over_alignment_test ) = U::is_over_alignment_test
+            ) noexcept
+            {
+                using memory_resource_type = typename test_heap< U >::memory_resource_type;
+                using accessor_type = typename test_heap< U >::accessor_type;
+                using pointer_type = typename accessor_type::pointer_type;
+
+                try
+                {
+                    memory_resource_type mr;
+                    auto page_size = static_cast< std::size_t >( accessor_type::system_page_size() );
+
+                    // small piece of a few pages alignment stays on the pool
+                    auto p = mr.allocate( 100, 2 * page_size );
+                    EXPECT_EQ( 0, reinterpret_cast< pointer_type >( p ) % static_cast< pointer_type >( 2 * page_size ) );
+                    EXPECT_EQ( 0, mr.get_snapshot().large_block_count_ );
+                    std::memset( p, 0xcc, 100 );
+                    mr.deallocate( p, 100, 2 * page_size );
+
+                    for ( std::size_t alignment : { std::size_t( 1 ) << 21, std::size_t( 1 ) << 24 } )
+                    {
+                        for ( std::size_t size : { std::size_t( 100 ), std::size_t( 3 ) << 20 } )
+                        {
+                            // large block gets mapped with exact alignment and no slack left mapped
+                            auto q = mr.allocate( size, alignment );
+                            EXPECT_EQ( 0, reinterpret_cast< pointer_type >( q ) % static_cast< pointer_type >( alignment ) );
+                            auto snapshot = mr.get_snapshot();
+                            EXPECT_EQ( 1, snapshot.large_block_count_ );
+                            EXPECT_GT( alignment + size, snapshot.large_block_bytes_ );
+                            std::memset( q, 0xcc, size );
+
+                            // alignment survives resizing
+                            q = mr.reallocate( q, size, 2 * size, alignment );
+                            ASSERT_NE( nullptr, q );
+                            EXPECT_EQ( 0, reinterpret_cast< pointer_type >( q ) % static_cast< pointer_type >( alignment ) );
+                            std::memset( q, 0xcc, 2 * size );
+
+                            mr.deallocate( q, 2 * size, alignment );
+                            EXPECT_EQ( 0, mr.get_snapshot().large_block_count_ );
+                        }
+                    }
+
+                    // released over-aligned block does not serve next request unless aligned
+                    auto r = mr.allocate( 100, std::size_t( 1 ) << 22 );
+                    EXPECT_EQ( 0, reinterpret_cast< pointer_type >( r ) % ( pointer_type( 1 ) << 22 ) );
+                    mr.deallocate( r, 100, std::size_t( 1 ) << 22 );
+                }
+                catch ( ... )
+                {
+                    GTEST_FAIL();
+                }
+            }
+
+            void operator()() const noexcept { run( T() ); }
+        };
+
+        TYPED_TEST( test_heap, over_alignment )
+        {
+            over_alignment_impl< TypeParam >()( );
+        }
+
+        //-----------------------------------------------------------------------------------------------------------------------------------------------------
+
+        template < typename T >
+        struct tlab_impl
+        {
+            static void run( ... ) noexcept {}
+
+            template < typename U >
+            static void run(
+                U&&,
+                decltype( U::is_tlab_test ) = U::is_tlab_test
+            ) noexcept
+            {
+                using memory_resource_type = typename test_heap< U >::memory_resource_type;
+                using accessor_type = typename test_heap< U >::accessor_type;
+                using pointer_type = typename accessor_type::pointer_type;
+
+                try
+                {
+                    constexpr std::size_t chunk_size = 4096, sz = 300, large_sz = 2000;
+                    auto offset = accessor_type::ceil( accessor_type::piece_internal_fields_size, 8 );
+                    auto block_size = accessor_type::ceil( offset + sz + accessor_type::piece_trailer_size, accessor_type::granularity );
+                    auto block_of = [ & ]( void* p ) { return reinterpret_cast< pointer_type >( p ) - offset; };
+
+                    memory_resource_type mr;
+                    auto unallocated = [ & ]() { return static_cast< pointer_type >( accessor_type::pool_begin( mr )->unallocated_ ); };
+                    auto chunk = unallocated();
+
+                    // the first piece claims a chunk, the following ones are carved from it one after another
+                    auto p1 = mr.allocate( sz, 8 );
+                    auto p2 = mr.allocate( sz, 8 );
+                    EXPECT_EQ( chunk, block_of( p1 ) );
+                    EXPECT_EQ( chunk + block_size, block_of( p2 ) );
+                    EXPECT_EQ( chunk + static_cast< pointer_type >( chunk_size ), unallocated() );
+                    EXPECT_EQ( 2, mr.get_statistics()[ event::tlab_allocation ] );
+                    EXPECT_EQ( 1, mr.get_statistics()[ event::pool_allocation ] );
+
+                    // piece exceeding quarter of chunk goes to the pool
+                    auto large = mr.allocate( large_sz, 8 );
+                    EXPECT_EQ( chunk + static_cast< pointer_type >( chunk_size ), block_of( large ) );
+                    EXPECT_EQ( 2, mr.get_statistics()[ event::pool_allocation ] );
+
+                    // rewind moves chunk of calling thread back
+                    auto m = mr.checkpoint();
+                    auto scratch = mr.allocate( sz, 8 );
+                    mr.rewind( m );
+                    auto p3 = mr.allocate( sz, 8 );
+                    EXPECT_EQ( scratch, p3 );
+
+                    // exhausted chunk gets retired, its tail goes to garbage
+                    std::vector< void* > pieces = { p1, p2, p3 };
+                    auto count = chunk_size / static_cast< std::size_t >( block_size );
+                    while ( pieces.size() < count ) pieces.push_back( mr.allocate( sz, 8 ) );
+                    EXPECT_EQ( 0, mr.get_snapshot().garbage_bytes_ );
+                    EXPECT_EQ( 2, mr.get_statistics()[ event::pool_allocation ] );
+                    pieces.push_back( mr.allocate( sz, 8 ) );
+                    EXPECT_EQ( 3, mr.get_statistics()[ event::pool_allocation ] );
+                    EXPECT_EQ( chunk_size % static_cast< std::size_t >( block_size ), mr.get_snapshot().garbage_bytes_ );
+
+                    // chunk of exited thread gets given back to the pool
+                    void* q = nullptr;
+                    std::thread( [ & ]() { q = mr.allocate( sz, 8 ); } ).join();
+                    EXPECT_EQ( block_of( q ) + block_size, unallocated() );
+
+                    // pieces carved from chunks are deallocated as usual
+                    mr.deallocate( q, sz, 8 );
+                    for ( auto p : pieces ) mr.deallocate( p, sz, 8 );
+                    mr.deallocate( large, large_sz, 8 );
+                }
+                catch ( ... )
+                {
+                    GTEST_FAIL();
+                }
+            }
+
+            void operator()() const noexcept { run( T() ); }
+        };
+
+        TYPED_TEST( test_heap, tlab )
+        {
+            tlab_impl< TypeParam >()( );
+        }
+
+        //-----------------------------------------------------------------------------------------------------------------------------------------------------
+
+        template < typename T >
+        struct thread_heap_impl
+        {
+            static void run( ... ) noexcept {}
+
+            template < typename U >
+            static void run(
+                U&&,
+                decltype( U::is_thread_heap_test ) = U::is_thread_heap_test
+            ) noexcept
+            {
+                using memory_resource_type = typename test_heap< U >::memory_resource_type;
+                using accessor_type = typename test_heap< U >::accessor_type;
+                using pointer_type = typename accessor_type::pointer_type;
+
+                try
+                {
+                    constexpr std::size_t heap_block_size = 1 << 16, sz = 100, large_sz = 5000;
+                    auto offset = accessor_type::ceil( accessor_type::piece_internal_fields_size, 8 );
+                    auto block_size = accessor_type::ceil( offset + sz + accessor_type::piece_trailer_size, accessor_type::granularity );
+                    auto block_of = [ & ]( void* p ) { return reinterpret_cast< pointer_type >( p ) - offset; };
+
+                    memory_resource_type mr;
+                    auto in_heap = [ & ]( void* p ) { return reinterpret_cast< pointer_type >( p ) >= accessor_type::heap_begin( mr ) && reinterpret_cast< pointer_type >( p ) < accessor_type::heap_end( mr ); };
+
+                    // heap range is reserved on first heap allocation
+                    EXPECT_EQ( 0, accessor_type::heap_begin( mr ) );
+
+                    // the first piece claims a heap block, the following ones are carved from it one after another
+                    auto p1 = mr.allocate( sz, 8 );
+                    auto p2 = mr.allocate( sz, 8 );
+                    EXPECT_TRUE( in_heap( p1 ) );
+                    EXPECT_EQ( block_of( p1 ) + block_size, block_of( p2 ) );
+                    EXPECT_EQ( heap_block_size, mr.get_snapshot().heap_bytes_ );
+                    EXPECT_EQ( 2, mr.get_statistics()[ event::heap_allocation ] );
+
+                    // piece exceeding heap size classes goes to the pool
+                    auto large = mr.allocate( large_sz, 8 );
+                    EXPECT_FALSE( in_heap( large ) );
+                    EXPECT_EQ( 2, mr.get_statistics()[ event::heap_allocation ] );
+
+                    // piece released by the owner stays in the owner's heap
+                    mr.deallocate( p1, sz, 8 );
+                    EXPECT_EQ( 0, mr.get_snapshot().garbage_bytes_ );
+                    EXPECT_EQ( p1, mr.allocate( sz, 8 ) );
+
+                    // piece released by another thread gets back to the owner
+                    std::thread( [ & ]() { mr.deallocate( p2, sz, 8 ); } ).join();
+                    EXPECT_EQ( 1, mr.get_statistics()[ event::remote_free ] );
+                    EXPECT_EQ( 0, mr.get_snapshot().garbage_bytes_ );
+                    EXPECT_EQ( p2, mr.allocate( sz, 8 ) );
+
+                    // another thread claims its own heap block, the block tail goes to garbage on thread exit
+                    void* q = nullptr;
+                    std::thread( [ & ]() { q = mr.allocate( sz, 8 ); } ).join();
+                    EXPECT_TRUE( in_heap( q ) );
+                    EXPECT_EQ( 2 * heap_block_size, mr.get_snapshot().heap_bytes_ );
+                    auto heap_block_capacity = static_cast< std::size_t >( heap_block_size - accessor_type::granularity );
+                    EXPECT_EQ( heap_block_capacity - block_size, mr.get_snapshot().garbage_bytes_ );
+
+                    // piece of exited owner goes to garbage
+                    mr.deallocate( q, sz, 8 );
+                    EXPECT_EQ( 1, mr.get_statistics()[ event::remote_free ] );
+                    EXPECT_EQ( heap_block_capacity, mr.get_snapshot().garbage_bytes_ );
+
+                    // thread reusing the state of exited one gets pieces released by other threads again
+                    std::thread( [ & ]() {
+                        auto r = mr.allocate( sz, 8 );
+                        EXPECT_TRUE( in_heap( r ) );
+                        std::thread( [ & ]() { mr.deallocate( r, sz, 8 ); } ).join();
+                        EXPECT_EQ( 2, mr.get_statistics()[ event::remote_free ] );
+                        EXPECT_EQ( r, mr.allocate( sz, 8 ) );
+                        mr.deallocate( r, sz, 8 );
+                    } ).join();
+
+                    // private free list keeps at most a heap block worth of pieces, the excess goes to garbage
+                    auto limit = static_cast< std::size_t >( heap_block_size / block_size );
+                    std::vector< void* > pieces;
+                    for ( std::size_t i = 0; i < 2 * limit; ++i ) pieces.push_back( mr.allocate( sz, 8 ) );
+                    auto garbage_bytes = mr.get_snapshot().garbage_bytes_;
+                    for ( auto p : pieces ) mr.deallocate( p, sz, 8 );
+                    EXPECT_EQ( limit * block_size, mr.get_snapshot().garbage_bytes_ - garbage_bytes );
+
+                    mr.deallocate( p1, sz, 8 );
+                    mr.deallocate( p2, sz, 8 );
+                    mr.deallocate( large, large_sz, 8 );
+                }
+                catch ( ... )
+                {
+                    GTEST_FAIL();
+                }
+            }
+
+            void operator()() const noexcept { run( T() ); }
+        };
+
+        TYPED_TEST( test_heap, thread_heap )
+        {
+            thread_heap_impl< TypeParam >()( );
+        }
+
+        //-----------------------------------------------------------------------------------------------------------------------------------------------------
+
+        template < typename T >
+        struct cpu_caches_impl
+        {
+            static void run( ... ) noexcept {}
+
+            template < typename U >
+            static void run(
+                U&&,
+                decltype( U::is_cpu_caches_test ) = U::is_cpu_caches_test
+            ) noexcept
+            {
+                using memory_resource_type = typename test_heap< U >::memory_resource_type;
+                using accessor_type = typename test_heap< U >::accessor_type;
+
+                constexpr std::size_t sz = 1;
+
+                // CPU caches are modified either by rseq critical sections or under try-lock
+                for ( auto critical_sections : { true, false } )
+                {
+                    try
+                    {
+                        if constexpr ( U::policy_type::magazine_size > 0 )
+                        {
+                            memory_resource_type mr;
+                            if ( !critical_sections ) accessor_type::disable_cpu_fence( mr );
+
+                            auto p = mr.allocate( sz, 1 );
+                            auto cached = mr.get_snapshot().cpu_cache_bytes_;
+                            mr.deallocate( p, sz, 1 );
+
+                            if ( accessor_type::current_cpu() < 0 )
+                            {
+                                // no rseq, released piece stays in the magazine of current thread
+                                EXPECT_EQ( 0, accessor_type::garbage_size( mr ) );
+                                EXPECT_EQ( 1, accessor_type::magazine_size( mr ) );
+                                EXPECT_EQ( 0, mr.get_snapshot().cpu_cache_bytes_ );
+                                return;
+                            }
+
+                            // released piece stays in the magazine of current CPU
+                            EXPECT_EQ( 0, accessor_type::garbage_size( mr ) );
+                            EXPECT_EQ( 0, accessor_type::magazine_size( mr ) );
+                            EXPECT_EQ( cached + accessor_type::granularity, mr.get_snapshot().cpu_cache_bytes_ );
+                            EXPECT_EQ( p, mr.allocate( sz, 1 ) );
+                            EXPECT_EQ( 1, mr.get_statistics()[ event::magazine_allocation ] );
+                            EXPECT_EQ( cached, mr.get_snapshot().cpu_cache_bytes_ );
+
+                            // exited thread leaves nothing to flush, the piece stays cached by its CPU
+                            std::thread( [ & ]() { mr.deallocate( p, sz, 1 ); } ).join();
+                            EXPECT_EQ( 0, accessor_type::garbage_size( mr ) );
+
+                            // trim() flushes magazines of all the CPUs to garbage
+                            mr.trim();
+                            EXPECT_EQ( 1, accessor_type::garbage_size( mr ) );
+                            EXPECT_EQ( 0, mr.get_snapshot().cpu_cache_bytes_ );
+
+                            // the magazine gets refilled from garbage and release() empties magazines of all the CPUs
+                            mr.deallocate( mr.allocate( sz, 1 ), sz, 1 );
+                            EXPECT_EQ( 2, mr.get_statistics()[ event::magazine_allocation ] );
+                            mr.release();
+                            p = mr.allocate( sz, 1 );
+                            EXPECT_EQ( 2, mr.get_statistics()[ event::magazine_allocation ] );
+                            EXPECT_EQ( 2, mr.get_statistics()[ event::pool_allocation ] );
+                            mr.deallocate( p, sz, 1 );
+                        }
+
+                        if constexpr ( U::policy_type::tlab_size > 0 )
+                        {
+                            memory_resource_type mr;
+                            if ( !critical_sections ) accessor_type::disable_cpu_fence( mr );
+
+                            // pieces are carved from the chunk of current CPU
+                            auto p1 = mr.allocate( sz, 1 );
+                            auto p2 = mr.allocate( sz, 1 );
+                            EXPECT_EQ( 2, mr.get_statistics()[ event::tlab_allocation ] );
+                            if ( accessor_type::current_cpu() < 0 )
+                            {
+                                // no rseq, the chunk belongs to current thread
+                                EXPECT_EQ( 0, mr.get_snapshot().cpu_cache_bytes_ );
+                                return;
+                            }
+                            auto tail = mr.get_snapshot().cpu_cache_bytes_;
+                            EXPECT_LT( 0, tail );
+
+                            // another thread carves the chunk of its CPU
+                            void* p3 = nullptr;
+                            std::thread( [ & ]() { p3 = mr.allocate( sz, 1 ); } ).join();
+                            EXPECT_EQ( 3, mr.get_statistics()[ event::tlab_allocation ] );
+
+                            // trim() gives the chunk tail back, the next piece claims a new chunk
+                            mr.trim();
+                            EXPECT_EQ( 0, mr.get_snapshot().cpu_cache_bytes_ );
+                            auto p4 = mr.allocate( sz, 1 );
+                            EXPECT_EQ( 4, mr.get_statistics()[ event::tlab_allocation ] );
+                            EXPECT_LT( 0, mr.get_snapshot().cpu_cache_bytes_ );
+
+                            for ( auto p : { p1, p2, p3, p4 } ) mr.deallocate( p, sz, 1 );
+                        }
+                    }
+                    catch ( ... )
+                    {
+                        GTEST_FAIL();
+                    }
+                }
+            }
+
+            void operator()() const noexcept { run( T() ); }
+        };
+
+        TYPED_TEST( test_heap, cpu_caches )
+        {
+            cpu_caches_impl< TypeParam >()( );
+        }
+
+        //-----------------------------------------------------------------------------------------------------------------------------------------------------
+
         TYPED_TEST( test_heap, compare_heaps )
         {
             using memory_resource_type = typename test_heap< TypeParam >::memory_resource_type;
@@ -0,0 +1,129 @@
+// MIT License
+//
+// Copyright( c ) 2021 Alexey Pavlyutkin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef __LOCK_FREE_MEMORY_RESOURCE_UT_POLICY__H__
+#define __LOCK_FREE_MEMORY_RESOURCE_UT_POLICY__H__
+
+
+#include <cstddef>
+
+
+namespace bits
+{
+    namespace ut
+    {
+        template < typename PolicyType, std::size_t BlockSize >
+        struct set_pool_block_size : public PolicyType
+        {
+            static constexpr std::size_t block_size = BlockSize;
+        };
+
+        template < typename PolicyType, std::size_t Granularity >
+        struct set_granularity : public PolicyType
+        {
+            static constexpr std::size_t granularity = Granularity;
+        };
+
+        template < typename PolicyType, std::size_t GarbageSearchDepth >
+        struct set_garbage_search_depth : public PolicyType
+        {
+            static constexpr std::size_t garbage_search_depth = GarbageSearchDepth;
+        };
+
+        template < typename PolicyType, std::size_t MagazineSize >
+        struct set_magazine_size : public PolicyType
+        {
+            static constexpr std::size_t magazine_size = MagazineSize;
+        };
+
+        template < typename PolicyType, bool Coalescing >
+        struct set_coalescing : public PolicyType
+        {
+            static constexpr bool coalescing = Coalescing;
+        };
+
+        template < typename PolicyType, std::size_t PurgeDecay >
+        struct set_purge_decay : public PolicyType
+        {
+            static constexpr std::size_t purge_decay = PurgeDecay;
+        };
+
+        template < typename PolicyType, std::size_t ReserveSize, std::size_t ReserveLowWatermark >
+        struct set_reserve_size : public PolicyType
+        {
+            static constexpr std::size_t reserve_size = ReserveSize;
+            static constexpr std::size_t reserve_low_watermark = ReserveLowWatermark;
+        };
+
+        template < typename PolicyType, bool Statistics >
+        struct set_statistics : public PolicyType
+        {
+            static constexpr bool statistics = Statistics;
+        };
+
+        template < typename PolicyType, bool HugePages >
+        struct set_huge_pages : public PolicyType
+        {
+            static constexpr bool huge_pages = HugePages;
+        };
+
+        template < typename PolicyType, std::size_t SlabMaxSize >
+        struct set_slab_max_size : public PolicyType
+        {
+            static constexpr std::size_t slab_max_size = SlabMaxSize;
+        };
+
+        template < typename PolicyType, std::size_t LargeCacheSize, std::size_t LargeCacheDecay >
+        struct set_large_cache : public PolicyType
+        {
+            static constexpr std::size_t large_cache_size = LargeCacheSize;
+            static constexpr std::size_t large_cache_decay = LargeCacheDecay;
+        };
+
+        template < typename PolicyType, bool TrustedSize >
+        struct set_trusted_size : public PolicyType
+        {
+            static constexpr bool trusted_size = TrustedSize;
+        };
+
+        template < typename PolicyType, std::size_t TlabSize >
+        struct set_tlab_size : public PolicyType
+        {
+            static constexpr std::size_t tlab_size = TlabSize;
+        };
+
+        template < typename PolicyType, std::size_t HeapBlockSize >
+        struct set_heap_block_size : public PolicyType
+        {
+            static constexpr std::size_t heap_block_size = HeapBlockSize;
+        };
+
+        template < typename PolicyType, bool CpuCaches >
+        struct set_cpu_caches : public PolicyType
+        {
+            static constexpr bool cpu_caches = CpuCaches;
+        };
+    }
+}
+
+#endif
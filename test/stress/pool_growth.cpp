@@ -0,0 +1,119 @@
+// MIT License
+//
+// Copyright( c ) 2021 Alexey Pavlyutkin
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#include <gtest/gtest.h>
+#include <lfmr/lock_free_memory_resource.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <utility>
+#include <vector>
+
+
+namespace bits
+{
+    namespace stress
+    {
+        //
+        // tiny pool blocks make every few allocations grow the pool
+        //
+        struct tiny_block_policy : public default_policy
+        {
+            static constexpr std::size_t block_size = 1 << 12;
+        };
+
+        static constexpr std::size_t thread_count = 8;
+        static constexpr std::size_t round_count = 64;
+        static constexpr std::size_t pieces_per_thread = 256;
+        static constexpr auto deadline = std::chrono::seconds( 60 );
+
+        //-----------------------------------------------------------------------------------------------------------------------------------------------------
+
+        TEST( pool_growth, concurrent_growth_completes )
+        {
+            using memory_resource_type = lock_free_memory_resource< tiny_block_policy >;
+
+            for ( std::size_t round = 0; round < round_count; ++round )
+            {
+                memory_resource_type mr;
+                std::atomic< std::size_t > ready = 0, finished = 0;
+                std::vector< std::vector< std::pair< unsigned char*, std::size_t > > > pieces( thread_count );
+
+                std::vector< std::thread > threads;
+                for ( std::size_t t = 0; t < thread_count; ++t )
+                {
+                    threads.emplace_back( [&, t]() {
+                        // start all the threads at once to make them race for growing
+                        ready.fetch_add( 1 );
+                        while ( ready.load() < thread_count ) std::this_thread::yield();
+
+                        for ( std::size_t i = 0; i < pieces_per_thread; ++i )
+                        {
+                            // each piece takes about a third of pool block
+                            std::size_t sz = 1024 + ( ( t * pieces_per_thread + i ) % 7 ) * 64;
+                            auto p = static_cast< unsigned char* >( mr.allocate( sz, 16 ) );
+                            std::memset( p, static_cast< int >( t + 1 ), sz );
+                            pieces[ t ].emplace_back( p, sz );
+                        }
+                        finished.fetch_add( 1 );
+                    } );
+                }
+
+                // losers of the growing race must never stall
+                for ( auto start = std::chrono::steady_clock::now(); finished.load() < thread_count; std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) ) )
+                {
+                    if ( std::chrono::steady_clock::now() - start > deadline )
+                    {
+                        ADD_FAILURE() << "pool growth stalled in round " << round;
+                        std::abort();
+                    }
+                }
+                for ( auto& thread : threads ) thread.join();
+
+                // pieces are intact and do not overlap
+                std::vector< std::pair< unsigned char*, std::size_t > > all;
+                for ( std::size_t t = 0; t < thread_count; ++t )
+                {
+                    for ( auto [ p, sz ] : pieces[ t ] )
+                    {
+                        ASSERT_TRUE( std::all_of( p, p + sz, [ t ]( unsigned char c ) { return c == t + 1; } ) );
+                        all.emplace_back( p, sz );
+                    }
+                }
+                std::sort( all.begin(), all.end() );
+                for ( std::size_t i = 1; i < all.size(); ++i )
+                {
+                    ASSERT_LE( all[ i - 1 ].first + all[ i - 1 ].second, all[ i ].first );
+                }
+
+                for ( auto [ p, sz ] : all ) mr.deallocate( p, sz, 16 );
+            }
+        }
+
+        //-----------------------------------------------------------------------------------------------------------------------------------------------------
+    }
+}